@@ -0,0 +1,544 @@
+//Benchmarks the collision, map loading and rendering hot paths
+//Usage: bench [--format json|csv] [--out path]
+
+#include "../src/game.h"
+#include "../src/boxbatch.h"
+#include "../src/spatialhash.h"
+#include <SDL2/SDL_image.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+//Timings of one benchmark, in nanoseconds per iteration
+struct BenchResult
+{
+	std::string name;
+	int samples;
+	int iterations;
+	double mean;
+	double p50;
+	double p99;
+	double min;
+};
+
+//Finished benchmarks
+std::vector<BenchResult> gResults;
+
+//Keeps results alive so the compiler can't drop the work
+volatile int gSink = 0;
+
+//Times samples runs of iterations calls to fn
+template<typename Function>
+void measure( const char* name, int samples, int iterations, Function fn )
+{
+	std::vector<double> times( samples );
+	double frequency = (double)SDL_GetPerformanceFrequency();
+
+	for( int sample = 0; sample < samples; ++sample )
+	{
+		Uint64 start = SDL_GetPerformanceCounter();
+		for( int i = 0; i < iterations; ++i )
+		{
+			fn( sample * iterations + i );
+		}
+		Uint64 end = SDL_GetPerformanceCounter();
+		times[ sample ] = ( end - start ) * 1e9 / frequency / iterations;
+	}
+
+	//Summarize
+	std::sort( times.begin(), times.end() );
+	BenchResult result;
+	result.name = name;
+	result.samples = samples;
+	result.iterations = iterations;
+	result.mean = 0;
+	for( int i = 0; i < samples; ++i )
+	{
+		result.mean += times[ i ] / samples;
+	}
+	result.p50 = times[ samples / 2 ];
+	result.p99 = times[ std::min( samples - 1, samples * 99 / 100 ) ];
+	result.min = times[ 0 ];
+	gResults.push_back( result );
+
+	fprintf( stderr, "%-24s mean %12.1f ns  p50 %12.1f ns  p99 %12.1f ns\n", name, result.mean, result.p50, result.p99 );
+}
+
+//Repeatable random numbers
+Uint32 gSeed = 12345;
+int benchRandom( int range )
+{
+	gSeed = gSeed * 1664525u + 1013904223u;
+	return (int)( ( gSeed >> 8 ) % (Uint32)range );
+}
+
+//What a movement job needs besides its range
+struct BenchMove
+{
+	Level* level;
+	int tickRate;
+};
+
+//Job bodies for the crowd benchmarks that time one step of a tick on its own
+void benchMoveJob( int first, int last, void* data )
+{
+	BenchMove* move = (BenchMove*)data;
+	gEntities.moveRange( *move->level, move->tickRate, first, last );
+}
+
+void benchSteerJob( int first, int last, void* data )
+{
+	gEntities.steerRange( *(const FlowField*)data, player::GAMBIT_VEL, first, last );
+}
+
+//Writes the results as JSON or CSV
+bool writeResults( FILE* out, bool csv )
+{
+	if( csv )
+	{
+		fprintf( out, "name,samples,iterations,mean_ns,p50_ns,p99_ns,min_ns\n" );
+		for( size_t i = 0; i < gResults.size(); ++i )
+		{
+			BenchResult& r = gResults[ i ];
+			fprintf( out, "%s,%d,%d,%.1f,%.1f,%.1f,%.1f\n", r.name.c_str(), r.samples, r.iterations, r.mean, r.p50, r.p99, r.min );
+		}
+	}
+	else
+	{
+		fprintf( out, "{\n  \"unit\": \"ns\",\n  \"benchmarks\": [\n" );
+		for( size_t i = 0; i < gResults.size(); ++i )
+		{
+			BenchResult& r = gResults[ i ];
+			fprintf( out, "    { \"name\": \"%s\", \"samples\": %d, \"iterations\": %d, \"mean\": %.1f, \"p50\": %.1f, \"p99\": %.1f, \"min\": %.1f }%s\n",
+				r.name.c_str(), r.samples, r.iterations, r.mean, r.p50, r.p99, r.min, i + 1 < gResults.size() ? "," : "" );
+		}
+		fprintf( out, "  ]\n}\n" );
+	}
+
+	return !ferror( out );
+}
+
+int main( int argc, char* args[] )
+{
+	//Read the settings
+	bool csv = false;
+	const char* outPath = NULL;
+	for( int i = 1; i < argc; ++i )
+	{
+		if( strcmp( args[ i ], "--format" ) == 0 && i + 1 < argc )
+		{
+			csv = strcmp( args[ ++i ], "csv" ) == 0;
+		}
+		else if( strcmp( args[ i ], "--out" ) == 0 && i + 1 < argc )
+		{
+			outPath = args[ ++i ];
+		}
+		else
+		{
+			fprintf( stderr, "Usage: %s [--format json|csv] [--out path]\n", args[ 0 ] );
+			return 1;
+		}
+	}
+	parseOptions( 1, args, gOptions );
+	initJobs();
+
+	//Level the benchmarks run on
+	Level level;
+	if( !setTiles( level ) )
+	{
+		fprintf( stderr, "Failed to load map!\n" );
+		return 1;
+	}
+
+	//Random boxes, the size of the player, anywhere in the level
+	const int BOXES = 1024;
+	std::vector<SDL_Rect> boxes( BOXES );
+	for( int i = 0; i < BOXES; ++i )
+	{
+		boxes[ i ].w = player::GAMBIT_WIDTH;
+		boxes[ i ].h = player::GAMBIT_HEIGHT;
+		boxes[ i ].x = benchRandom( level.getWidth() - boxes[ i ].w );
+		boxes[ i ].y = benchRandom( level.getHeight() - boxes[ i ].h );
+	}
+
+	//Micro benchmarks
+	measure( "checkCollision", 200, 100000, [&]( int i )
+	{
+		gSink += checkCollision( boxes[ i & ( BOXES - 1 ) ], boxes[ ( i * 7 + 3 ) & ( BOXES - 1 ) ] );
+	} );
+
+	//One box against all of them, pair by pair and in a batch with each kernel the CPU has
+	measure( "collide/pairwise", 200, 100, [&]( int i )
+	{
+		SDL_Rect& box = boxes[ i & ( BOXES - 1 ) ];
+		int hits = 0;
+		for( int j = 0; j < BOXES; ++j )
+		{
+			hits += checkCollision( box, boxes[ j ] );
+		}
+		gSink += hits;
+	} );
+
+	BoxBatch batch;
+	for( int i = 0; i < BOXES; ++i )
+	{
+		batch.add( boxes[ i ] );
+	}
+	std::vector<Uint32> masks( batch.getMaskWords() );
+	BoxKernel bestKernel = BoxBatch::getKernel();
+	for( int kernel = 0; kernel < BOX_KERNEL_TOTAL; ++kernel )
+	{
+		if( BoxBatch::useKernel( (BoxKernel)kernel ) )
+		{
+			std::string name = std::string( "collide/" ) + BoxBatch::getKernelName( (BoxKernel)kernel );
+			measure( name.c_str(), 200, 100, [&]( int i )
+			{
+				gSink += batch.testOverlaps( boxes[ i & ( BOXES - 1 ) ], &masks[ 0 ] );
+			} );
+		}
+	}
+	BoxBatch::useKernel( bestKernel );
+
+	measure( "touchesWall", 200, 10000, [&]( int i )
+	{
+		gSink += touchesWall( boxes[ i & ( BOXES - 1 ) ], level );
+	} );
+
+	//A tick's step and a long dash, which costs more only by the tiles crossed
+	for( int distance : { 8, 800 } )
+	{
+		std::string name = "sweep/" + std::to_string( distance );
+		measure( name.c_str(), 200, 10000, [&]( int i )
+		{
+			SDL_Rect box = boxes[ i & ( BOXES - 1 ) ];
+			TileHit hit;
+			gSink += level.sweep( box, ( i & 2 ) ? distance : -distance, ( i & 1 ) ? distance : -distance, hit );
+		} );
+	}
+
+	measure( "setTiles", 50, 20, [&]( int )
+	{
+		Level loaded;
+		gSink += setTiles( loaded );
+	} );
+
+	measure( "map/text", 50, 20, [&]( int )
+	{
+		Level loaded;
+		gSink += loaded.loadFromFile( "maps/level1.map" );
+	} );
+
+	//The same level run length encoded
+	Level compressed;
+	if( setTiles( compressed ) && compressed.compress() )
+	{
+		measure( "tiles/dense", 200, 10000, [&]( int i )
+		{
+			SDL_Rect& box = boxes[ i & ( BOXES - 1 ) ];
+			gSink += level.getType( box.x / TILE_WIDTH, box.y / TILE_HEIGHT );
+		} );
+
+		measure( "tiles/runs", 200, 10000, [&]( int i )
+		{
+			SDL_Rect& box = boxes[ i & ( BOXES - 1 ) ];
+			gSink += compressed.getType( box.x / TILE_WIDTH, box.y / TILE_HEIGHT );
+		} );
+
+		measure( "touchesWall/runs", 200, 10000, [&]( int i )
+		{
+			gSink += touchesWall( boxes[ i & ( BOXES - 1 ) ], compressed );
+		} );
+
+		//Memory against dense storage, here and on a world tiled from the level
+		const int REPEAT = 40;
+		int columns = level.getColumns() * REPEAT;
+		int rows = level.getRows() * REPEAT;
+		std::vector<Uint8> world( (size_t)columns * rows );
+		for( int row = 0; row < rows; ++row )
+		{
+			for( int col = 0; col < columns; ++col )
+			{
+				world[ (size_t)row * columns + col ] = (Uint8)level.getType( col % level.getColumns(), row % level.getRows() );
+			}
+		}
+		TileRuns runs;
+		runs.build( &world[ 0 ], columns, rows );
+
+		//The level on its own, without the solid mask kept beside its runs
+		std::vector<Uint8> tiles( level.getTotalTiles() );
+		for( int row = 0; row < level.getRows(); ++row )
+		{
+			for( int col = 0; col < level.getColumns(); ++col )
+			{
+				tiles[ (size_t)row * level.getColumns() + col ] = (Uint8)level.getType( col, row );
+			}
+		}
+		TileRuns levelRuns;
+		levelRuns.build( &tiles[ 0 ], level.getColumns(), level.getRows() );
+
+		fprintf( stderr, "tiles/level memory       dense %10lu bytes  runs %10lu bytes\n", (unsigned long)tiles.size(), (unsigned long)levelRuns.getMemoryUsage() );
+		fprintf( stderr, "tiles/world memory       dense %10lu bytes  runs %10lu bytes, %d runs\n", (unsigned long)world.size(), (unsigned long)runs.getMemoryUsage(), runs.getRunCount() );
+	}
+
+	//A crowd walking about the level, a tick or an animation step at a time
+	const int CROWD = 50000;
+	spawnCrowd( level, CROWD );
+	measure( "entities/move", 50, 10, [&]( int )
+	{
+		gEntities.savePositions();
+		gEntities.move( level, DEFAULT_TICK_RATE );
+	} );
+
+	measure( "entities/animate", 50, 10, [&]( int )
+	{
+		gEntities.animate( 1000 / 60 );
+	} );
+
+	//The same spread over the job threads
+	fprintf( stderr, "jobs: %d threads\n", gJobs.getThreadCount() );
+	measure( "entities/move/jobs", 50, 10, [&]( int )
+	{
+		BenchMove move = { &level, DEFAULT_TICK_RATE };
+		gEntities.savePositions();
+		gJobs.wait( gJobs.parallelFor( benchMoveJob, &move, gEntities.getCount(), ENTITY_JOB_GRAIN ) );
+		gJobs.reset();
+	} );
+
+	measure( "entities/animate/jobs", 50, 10, [&]( int )
+	{
+		animateEntities( 1000 / 60 );
+	} );
+
+	gEntities.clear();
+
+	//The crowd heading for the dock along one shared flow field
+	gOptions.seekDock = true;
+	spawnCrowd( level, CROWD );
+	int dock = findTile( level, TILE_DOCK );
+	measure( "crowd/steer", 50, 10, [&]( int )
+	{
+		gPaths.update( gJobs, PATH_QUERIES_PER_TICK );
+		const FlowField* field = dock >= 0 ? gPaths.getFlowField( dock ) : NULL;
+		if( field != NULL )
+		{
+			gJobs.wait( gJobs.parallelFor( benchSteerJob, (void*)field, gEntities.getCount(), ENTITY_JOB_GRAIN ) );
+			gJobs.reset();
+		}
+	} );
+	gEntities.clear();
+
+	//A whole tick as one chain of jobs, steering then moving then the contacts
+	//A smaller crowd, as one this size piling onto the dock makes the contacts the whole story
+	std::vector<EntityPair> contacts;
+	int candidates = 0;
+	spawnCrowd( level, CROWD / 10 );
+	measure( "tick/chain", 50, 1, [&]( int )
+	{
+		gEntities.savePositions();
+		gSink += updateEntities( level, contacts, candidates );
+	} );
+	gEntities.clear();
+	gOptions.seekDock = false;
+
+	//Routes between open tiles, random pairs are rarely in the cache
+	gPaths.init( &level );
+	std::vector<int> openTiles;
+	for( int i = 0; i < level.getTotalTiles(); ++i )
+	{
+		if( !level.isSolid( i % level.getColumns(), i / level.getColumns() ) )
+		{
+			openTiles.push_back( i );
+		}
+	}
+	std::vector<int> route;
+	measure( "path/jps", 200, 100, [&]( int )
+	{
+		gSink += gPaths.findPath( openTiles[ benchRandom( (int)openTiles.size() ) ], openTiles[ benchRandom( (int)openTiles.size() ) ], route );
+	} );
+
+	measure( "path/cached", 200, 1000, [&]( int )
+	{
+		gSink += gPaths.findPath( openTiles.front(), openTiles.back(), route );
+	} );
+
+	measure( "path/batch", 50, 10, [&]( int )
+	{
+		PathId ids[ PATH_QUERIES_PER_TICK ];
+		for( int i = 0; i < PATH_QUERIES_PER_TICK; ++i )
+		{
+			ids[ i ] = gPaths.request( openTiles[ benchRandom( (int)openTiles.size() ) ], openTiles[ benchRandom( (int)openTiles.size() ) ] );
+		}
+		gPaths.finish( gJobs );
+		for( int i = 0; i < PATH_QUERIES_PER_TICK; ++i )
+		{
+			gSink += gPaths.getState( ids[ i ] );
+			gPaths.release( ids[ i ] );
+		}
+	} );
+
+	//More goals than fields kept, so each one is built from scratch, and waited for
+	measure( "flow/build", 50, 10, [&]( int i )
+	{
+		int goal = openTiles[ ( i * 97 ) % openTiles.size() ];
+		gPaths.getFlowField( goal );
+		gPaths.finish( gJobs );
+		gSink += gPaths.getFlowField( goal )->directions[ 0 ];
+	} );
+
+	//Boxes spread over a field with room for a 200 pixel square each, a busy but walkable crowd
+	auto spreadBoxes = [&]( BoxBatch& batch, int count )
+	{
+		int side = (int)sqrt( (double)count ) * 200;
+		batch.clear();
+		for( int i = 0; i < count; ++i )
+		{
+			SDL_Rect box = { benchRandom( side ), benchRandom( side ), player::GAMBIT_WIDTH, player::GAMBIT_HEIGHT };
+			batch.add( box );
+		}
+	};
+
+	//Entity against entity, candidates from the grid then the exact test
+	std::vector<BoxPair> pairs;
+	auto gridContacts = [&]( BoxBatch& batch, SpatialHash& grid )
+	{
+		grid.build( batch );
+		grid.findPairs( batch, pairs );
+		int touching = 0;
+		for( size_t i = 0; i < pairs.size(); ++i )
+		{
+			touching += checkCollision( batch.get( pairs[ i ].a ), batch.get( pairs[ i ].b ) );
+		}
+		return touching;
+	};
+
+	BoxBatch crowd;
+	SpatialHash grid;
+	const int CONTACT_CROWDS[ 2 ] = { 2000, CROWD };
+	for( int size = 0; size < 2; ++size )
+	{
+		int count = CONTACT_CROWDS[ size ];
+		spreadBoxes( crowd, count );
+
+		std::string name = "contacts/grid/" + std::to_string( count );
+		int touching = 0;
+		measure( name.c_str(), 50, 10, [&]( int )
+		{
+			touching = gridContacts( crowd, grid );
+			gSink += touching;
+		} );
+		fprintf( stderr, "%-24s %d boxes, %d candidate pairs, %d touching\n", name.c_str(), count, (int)pairs.size(), touching );
+
+		//Pair by pair only holds up for the small crowd
+		if( count <= 2000 )
+		{
+			name = "contacts/naive/" + std::to_string( count );
+			measure( name.c_str(), 10, 1, [&]( int )
+			{
+				int touching = 0;
+				for( int a = 0; a < count; ++a )
+				{
+					for( int b = a + 1; b < count; ++b )
+					{
+						touching += checkCollision( crowd.get( a ), crowd.get( b ) );
+					}
+				}
+				gSink += touching;
+			} );
+		}
+	}
+
+	//Everything on one screen of the big crowd
+	std::vector<int> hits;
+	grid.build( crowd );
+	measure( "contacts/query", 200, 100, [&]( int i )
+	{
+		SDL_Rect view = { ( i * 37 ) % 4000, ( i * 53 ) % 4000, SCREEN_WIDTH, SCREEN_HEIGHT };
+		gSink += grid.query( crowd, view, hits );
+	} );
+
+	//Fixed camera path sweeping the level corner to corner and back
+	const int PATH_FRAMES = 600;
+	std::vector<SDL_Rect> path( PATH_FRAMES );
+	for( int i = 0; i < PATH_FRAMES; ++i )
+	{
+		int step = i < PATH_FRAMES / 2 ? i : PATH_FRAMES - i;
+		path[ i ].w = SCREEN_WIDTH;
+		path[ i ].h = SCREEN_HEIGHT;
+		path[ i ].x = ( level.getWidth() - SCREEN_WIDTH ) * step / ( PATH_FRAMES / 2 );
+		path[ i ].y = ( level.getHeight() - SCREEN_HEIGHT ) * step / ( PATH_FRAMES / 2 );
+	}
+
+	//Render into memory with the software renderer
+	SDL_Surface* screen = NULL;
+	if( SDL_Init( 0 ) < 0 )
+	{
+		fprintf( stderr, "SDL could not initialize! SDL Error: %s\n", SDL_GetError() );
+	}
+	else
+	{
+		IMG_Init( IMG_INIT_PNG );
+		screen = SDL_CreateRGBSurfaceWithFormat( 0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_RGBA32 );
+	}
+	gRenderer = screen != NULL ? SDL_CreateSoftwareRenderer( screen ) : NULL;
+	if( gRenderer == NULL || !loadMedia( level ) )
+	{
+		fprintf( stderr, "Skipping render benchmarks, no software renderer or textures! SDL Error: %s\n", SDL_GetError() );
+	}
+	else
+	{
+		//Tiles drawn through the batch every frame
+		gChunkCache.free();
+		measure( "render/batched", 100, 10, [&]( int i )
+		{
+			gSink += renderLevel( level, path[ i % PATH_FRAMES ] );
+		} );
+
+		//Tiles drawn from prebaked chunks
+		gChunkCache.init( gRenderer, level );
+		measure( "render/chunked", 100, 10, [&]( int i )
+		{
+			gSink += renderLevel( level, path[ i % PATH_FRAMES ] );
+		} );
+
+		//Whole frames along the camera path, one sample per frame
+		player player;
+		measure( "frame/full", PATH_FRAMES, 1, [&]( int i )
+		{
+			gSink += renderFrame( level, path[ i % PATH_FRAMES ], 1.0f );
+			SDL_RenderPresent( gRenderer );
+		} );
+
+		//The crowd culled and drawn in one batch
+		spawnCrowd( level, CROWD );
+		measure( "entities/render", 100, 10, [&]( int i )
+		{
+			gSink += gEntities.render( gRenderer, path[ i % PATH_FRAMES ], 0.5f, gGambitTexture.getTexture(), gGambitTexture.getWidth(), gGambitTexture.getHeight(), gGambitAtlas );
+		} );
+	}
+
+	//Write the results
+	FILE* out = outPath != NULL ? fopen( outPath, "w" ) : stdout;
+	if( out == NULL )
+	{
+		fprintf( stderr, "Unable to open %s for writing!\n", outPath );
+		return 1;
+	}
+	bool written = writeResults( out, csv );
+	if( out != stdout )
+	{
+		written = fclose( out ) == 0 && written;
+	}
+
+	//Free resources
+	close( level );
+	if( screen != NULL )
+	{
+		SDL_FreeSurface( screen );
+	}
+
+	return written ? 0 : 1;
+}
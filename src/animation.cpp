@@ -0,0 +1,50 @@
+#include "animation.h"
+
+Animation::Animation()
+{
+	//Initialize
+	mClip = NULL;
+	mFrame = 0;
+	mTime = 0;
+}
+
+void Animation::play( const AnimationClip* clip )
+{
+	//Keep going if this clip is already playing
+	if( clip == mClip )
+	{
+		return;
+	}
+
+	//Start the new clip from the top
+	mClip = clip;
+	mFrame = 0;
+	mTime = 0;
+}
+
+void Animation::update( Uint32 elapsed )
+{
+	//Nothing to advance
+	if( mClip == NULL || mClip->count == 0 )
+	{
+		return;
+	}
+
+	//Step through as many frames as the time covers
+	mTime += elapsed;
+	while( mClip->frames[ mFrame ].duration > 0 && mTime >= mClip->frames[ mFrame ].duration )
+	{
+		mTime -= mClip->frames[ mFrame ].duration;
+		mFrame = ( mFrame + 1 ) % mClip->count;
+	}
+}
+
+int Animation::getSprite()
+{
+	if( mClip == NULL || mClip->count == 0 )
+	{
+		return 0;
+	}
+
+	return mClip->frames[ mFrame ].sprite;
+}
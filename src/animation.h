@@ -0,0 +1,45 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include <SDL2/SDL.h>
+
+//One sprite of an animation and how long it shows, 0 holds it forever
+struct AnimationFrame
+{
+	int sprite;
+	Uint32 duration;
+};
+
+//A looping sequence of frames
+struct AnimationClip
+{
+	const AnimationFrame* frames;
+	int count;
+};
+
+//Plays animation clips against elapsed time, clips are never copied
+class Animation
+{
+	public:
+		//Initializes variables
+		Animation();
+
+		//Switches to a clip, restarting it unless it's already playing
+		void play( const AnimationClip* clip );
+
+		//Advances the current clip by elapsed milliseconds
+		void update( Uint32 elapsed );
+
+		//Gets the sprite to show now
+		int getSprite();
+
+	private:
+		//The clip being played
+		const AnimationClip* mClip;
+
+		//Current frame and the time spent on it
+		int mFrame;
+		Uint32 mTime;
+};
+
+#endif
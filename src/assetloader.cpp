@@ -0,0 +1,275 @@
+#include "assetloader.h"
+#include "trace.h"
+#include <SDL2/SDL_image.h>
+#include <stdio.h>
+
+AssetLoader::AssetLoader()
+{
+	//Initialize
+	mLock = NULL;
+	mWorkReady = NULL;
+	mQuit = false;
+	mFinished = 0;
+	mBatchStart = 0;
+	mProgress = NULL;
+	mProgressData = NULL;
+}
+
+AssetLoader::~AssetLoader()
+{
+	free();
+}
+
+bool AssetLoader::init( int threads )
+{
+	free();
+
+	mLock = SDL_CreateMutex();
+	mWorkReady = SDL_CreateCond();
+	if( mLock == NULL || mWorkReady == NULL )
+	{
+		printf( "Unable to create loader lock! SDL Error: %s\n", SDL_GetError() );
+		free();
+		return false;
+	}
+
+	//Start the workers
+	mQuit = false;
+	for( int i = 0; i < threads; ++i )
+	{
+		SDL_Thread* thread = SDL_CreateThread( workerMain, "loader", this );
+		if( thread == NULL )
+		{
+			printf( "Unable to create loader thread! SDL Error: %s\n", SDL_GetError() );
+			break;
+		}
+		mThreads.push_back( thread );
+	}
+
+	if( mThreads.empty() )
+	{
+		free();
+		return false;
+	}
+
+	return true;
+}
+
+void AssetLoader::free()
+{
+	//Let the workers drain the queue and stop
+	if( mLock != NULL )
+	{
+		SDL_LockMutex( mLock );
+		mQuit = true;
+		SDL_CondBroadcast( mWorkReady );
+		SDL_UnlockMutex( mLock );
+	}
+	for( size_t i = 0; i < mThreads.size(); ++i )
+	{
+		SDL_WaitThread( mThreads[ i ], NULL );
+	}
+	mThreads.clear();
+
+	//Drop uncollected images and the assets
+	for( size_t i = 0; i < mAssets.size(); ++i )
+	{
+		if( mAssets[ i ]->surface != NULL )
+		{
+			SDL_FreeSurface( mAssets[ i ]->surface );
+		}
+		delete mAssets[ i ];
+	}
+	mAssets.clear();
+	mWork.clear();
+	mDone.clear();
+	mFinished = 0;
+	mBatchStart = 0;
+
+	if( mWorkReady != NULL )
+	{
+		SDL_DestroyCond( mWorkReady );
+		mWorkReady = NULL;
+	}
+	if( mLock != NULL )
+	{
+		SDL_DestroyMutex( mLock );
+		mLock = NULL;
+	}
+}
+
+AssetHandle AssetLoader::loadImage( std::string path, ImageUpload upload, void* data )
+{
+	Asset* asset = new Asset;
+	asset->path = path;
+	asset->upload = upload;
+	asset->uploadData = data;
+	asset->level = NULL;
+	asset->parse = NULL;
+
+	return queue( asset );
+}
+
+AssetHandle AssetLoader::loadLevel( Level* level, LevelParse parse )
+{
+	Asset* asset = new Asset;
+	asset->upload = NULL;
+	asset->uploadData = NULL;
+	asset->level = level;
+	asset->parse = parse;
+
+	return queue( asset );
+}
+
+AssetHandle AssetLoader::queue( Asset* asset )
+{
+	asset->surface = NULL;
+	asset->parsed = false;
+	asset->state = ASSET_PENDING;
+
+	SDL_LockMutex( mLock );
+	AssetHandle handle = (AssetHandle)mAssets.size();
+	mAssets.push_back( asset );
+	if( mThreads.empty() )
+	{
+		//No workers, load it right here
+		work( asset );
+		mDone.push_back( asset );
+	}
+	else
+	{
+		mWork.push_back( asset );
+		SDL_CondSignal( mWorkReady );
+	}
+	SDL_UnlockMutex( mLock );
+
+	return handle;
+}
+
+bool AssetLoader::update()
+{
+	//Take what the workers finished
+	SDL_LockMutex( mLock );
+	std::deque<Asset*> done;
+	done.swap( mDone );
+	SDL_UnlockMutex( mLock );
+
+	for( size_t i = 0; i < done.size(); ++i )
+	{
+		Asset* asset = done[ i ];
+		if( asset->parse != NULL )
+		{
+			asset->state = asset->parsed ? ASSET_READY : ASSET_FAILED;
+		}
+		else if( asset->surface == NULL )
+		{
+			asset->state = ASSET_FAILED;
+		}
+		else
+		{
+			//Textures have to be made on the render thread
+			TRACE_SCOPE( "AssetLoader::upload" );
+			asset->state = asset->upload( asset->path, asset->surface, asset->uploadData ) ? ASSET_READY : ASSET_FAILED;
+			SDL_FreeSurface( asset->surface );
+			asset->surface = NULL;
+		}
+
+		mFinished++;
+		if( mProgress != NULL )
+		{
+			mProgress( mFinished - mBatchStart, (int)mAssets.size() - mBatchStart, mProgressData );
+		}
+	}
+
+	return mFinished == (int)mAssets.size();
+}
+
+bool AssetLoader::finish()
+{
+	while( !update() )
+	{
+		//Keep the window responsive while waiting
+		SDL_PumpEvents();
+		SDL_Delay( 1 );
+	}
+
+	//Check everything since the last finish arrived
+	bool success = true;
+	for( size_t i = mBatchStart; i < mAssets.size(); ++i )
+	{
+		if( mAssets[ i ]->state != ASSET_READY )
+		{
+			success = false;
+		}
+	}
+	mBatchStart = (int)mAssets.size();
+
+	return success;
+}
+
+AssetState AssetLoader::getState( AssetHandle handle )
+{
+	if( handle < 0 || handle >= (int)mAssets.size() )
+	{
+		return ASSET_FAILED;
+	}
+
+	return mAssets[ handle ]->state;
+}
+
+void AssetLoader::setProgressCallback( LoadProgress callback, void* data )
+{
+	mProgress = callback;
+	mProgressData = data;
+}
+
+int AssetLoader::workerMain( void* loader )
+{
+	AssetLoader* self = (AssetLoader*)loader;
+	traceThreadName( "loader" );
+
+	SDL_LockMutex( self->mLock );
+	while( true )
+	{
+		//Wait for work or for the quit signal
+		while( self->mWork.empty() && !self->mQuit )
+		{
+			SDL_CondWait( self->mWorkReady, self->mLock );
+		}
+		if( self->mWork.empty() )
+		{
+			break;
+		}
+
+		Asset* asset = self->mWork.front();
+		self->mWork.pop_front();
+
+		//Load without holding the lock
+		SDL_UnlockMutex( self->mLock );
+		self->work( asset );
+		SDL_LockMutex( self->mLock );
+
+		self->mDone.push_back( asset );
+	}
+	SDL_UnlockMutex( self->mLock );
+
+	return 0;
+}
+
+void AssetLoader::work( Asset* asset )
+{
+	if( asset->parse != NULL )
+	{
+		TRACE_SCOPE( "AssetLoader::parse" );
+		asset->parsed = asset->parse( *asset->level );
+	}
+	else
+	{
+		TRACE_SCOPE( "AssetLoader::decode" );
+		asset->surface = IMG_Load( asset->path.c_str() );
+		if( asset->surface == NULL )
+		{
+			printf( "Unable to load image %s! SDL_image Error: %s\n", asset->path.c_str(), IMG_GetError() );
+		}
+	}
+}
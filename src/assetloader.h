@@ -0,0 +1,116 @@
+#ifndef ASSETLOADER_H
+#define ASSETLOADER_H
+
+#include <SDL2/SDL.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include "level.h"
+
+//Identifies a queued asset
+typedef int AssetHandle;
+
+//Where an asset is in loading
+enum AssetState
+{
+	ASSET_PENDING,
+	ASSET_READY,
+	ASSET_FAILED
+};
+
+//Turns a decoded image into a texture on the render thread, returns success
+typedef bool (*ImageUpload)( const std::string& path, SDL_Surface* surface, void* data );
+
+//Parses a map into a level on a worker thread, returns success
+typedef bool (*LevelParse)( Level& level );
+
+//Reports finished and queued asset counts on the render thread
+typedef void (*LoadProgress)( int done, int total, void* data );
+
+//Decodes images and parses maps on worker threads, then finishes them on the render thread
+class AssetLoader
+{
+	public:
+		//Initializes variables
+		AssetLoader();
+
+		//Stops the workers
+		~AssetLoader();
+
+		//Starts the worker threads
+		bool init( int threads );
+
+		//Waits for queued work and stops the workers
+		void free();
+
+		//Queues an image to decode, upload is called with it from update
+		AssetHandle loadImage( std::string path, ImageUpload upload, void* data );
+
+		//Queues a level to parse
+		AssetHandle loadLevel( Level* level, LevelParse parse );
+
+		//Finishes assets the workers are done with, true once nothing is pending
+		bool update();
+
+		//Runs update until nothing is pending, true if every asset queued since the last finish loaded
+		bool finish();
+
+		//Gets how far an asset got
+		AssetState getState( AssetHandle handle );
+
+		//Sets the function told about progress
+		void setProgressCallback( LoadProgress callback, void* data );
+
+		//Whether the workers are running
+		bool isRunning() { return !mThreads.empty(); }
+
+	private:
+		//A queued asset
+		struct Asset
+		{
+			//Image to decode, or level to parse
+			std::string path;
+			ImageUpload upload;
+			void* uploadData;
+			Level* level;
+			LevelParse parse;
+
+			//Worker results
+			SDL_Surface* surface;
+			bool parsed;
+
+			AssetState state;
+		};
+
+		//Worker thread entry point
+		static int workerMain( void* loader );
+
+		//Decodes or parses one asset
+		void work( Asset* asset );
+
+		//Adds an asset to the work queue
+		AssetHandle queue( Asset* asset );
+
+		//Every asset queued, indexed by handle
+		std::vector<Asset*> mAssets;
+
+		//Assets waiting for a worker, and waiting for the render thread
+		std::deque<Asset*> mWork;
+		std::deque<Asset*> mDone;
+
+		//Guards the queues and the quit flag
+		SDL_mutex* mLock;
+		SDL_cond* mWorkReady;
+		bool mQuit;
+
+		//The workers
+		std::vector<SDL_Thread*> mThreads;
+
+		//Progress, counted from the first asset after the last finish
+		int mFinished;
+		int mBatchStart;
+		LoadProgress mProgress;
+		void* mProgressData;
+};
+
+#endif
@@ -0,0 +1,158 @@
+#include "atlas.h"
+#include <stdio.h>
+#include <fstream>
+#include <sstream>
+
+Atlas::Atlas()
+{
+	//Initialize
+	mClips = NULL;
+	mCount = 0;
+	mEmpty.x = 0;
+	mEmpty.y = 0;
+	mEmpty.w = 0;
+	mEmpty.h = 0;
+}
+
+void Atlas::setRects( const SDL_Rect* rects, int count )
+{
+	free();
+	mClips = rects;
+	mCount = count;
+}
+
+void Atlas::setGrid( int spriteWidth, int spriteHeight, int columns, int rows )
+{
+	free();
+	for( int row = 0; row < rows; ++row )
+	{
+		for( int col = 0; col < columns; ++col )
+		{
+			SDL_Rect clip = { col * spriteWidth, row * spriteHeight, spriteWidth, spriteHeight };
+			mOwned.push_back( clip );
+		}
+	}
+	mClips = mOwned.empty() ? NULL : &mOwned[ 0 ];
+	mCount = (int)mOwned.size();
+}
+
+bool Atlas::loadFromFile( std::string path, std::string group )
+{
+	//Get rid of preexisting clips
+	free();
+
+	//Open the descriptor
+	std::ifstream descriptor( path.c_str() );
+	if( !descriptor.is_open() )
+	{
+		printf( "Unable to load atlas %s!\n", path.c_str() );
+		return false;
+	}
+
+	//Read it line by line
+	std::string line;
+	int lineNumber = 0;
+	bool success = true;
+	while( success && std::getline( descriptor, line ) )
+	{
+		lineNumber++;
+		std::istringstream fields( line );
+		std::string command;
+
+		//Skip blank lines and comments
+		if( !( fields >> command ) || command[ 0 ] == '#' )
+		{
+			continue;
+		}
+
+		if( command == "image" )
+		{
+			success = (bool)( fields >> mImagePath );
+		}
+		else if( command == "grid" )
+		{
+			//Cells follow the sprites already defined, they have no names so belong to no group
+			int width, height, columns, rows;
+			success = (bool)( fields >> width >> height >> columns >> rows ) && width > 0 && height > 0;
+			for( int row = 0; success && group.empty() && row < rows; ++row )
+			{
+				for( int col = 0; col < columns; ++col )
+				{
+					SDL_Rect clip = { col * width, row * height, width, height };
+					mOwned.push_back( clip );
+				}
+			}
+		}
+		else if( command == "sprite" )
+		{
+			int id;
+			SDL_Rect clip;
+			std::string name;
+			success = (bool)( fields >> id >> clip.x >> clip.y >> clip.w >> clip.h ) && id >= 0;
+			fields >> name;
+
+			//Group members take the ID after the slash
+			bool member = true;
+			if( success && !group.empty() )
+			{
+				std::istringstream suffix( name.compare( 0, group.size() + 1, group + "/" ) == 0 ? name.substr( group.size() + 1 ) : "" );
+				member = (bool)( suffix >> id ) && suffix.eof() && id >= 0;
+			}
+
+			if( success && member )
+			{
+				if( !name.empty() )
+				{
+					mIds[ name ] = id;
+				}
+
+				//Grow the table up to this ID
+				if( id >= (int)mOwned.size() )
+				{
+					mOwned.resize( id + 1, mEmpty );
+				}
+				mOwned[ id ] = clip;
+			}
+		}
+		else
+		{
+			success = false;
+		}
+
+		if( !success )
+		{
+			printf( "Error loading atlas %s: Bad line %d!\n", path.c_str(), lineNumber );
+		}
+	}
+
+	//A group has to be there
+	if( success && !group.empty() && mOwned.empty() )
+	{
+		success = false;
+	}
+
+	if( !success )
+	{
+		free();
+		return false;
+	}
+
+	mClips = mOwned.empty() ? NULL : &mOwned[ 0 ];
+	mCount = (int)mOwned.size();
+	return true;
+}
+
+int Atlas::getId( std::string name )
+{
+	std::unordered_map<std::string, int>::iterator found = mIds.find( name );
+	return found != mIds.end() ? found->second : -1;
+}
+
+void Atlas::free()
+{
+	std::vector<SDL_Rect>().swap( mOwned );
+	mIds.clear();
+	mImagePath.clear();
+	mClips = NULL;
+	mCount = 0;
+}
@@ -0,0 +1,64 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include <SDL2/SDL.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+//Maps sprite IDs to their clip rects on a sprite sheet
+//Built in sheets use constexpr rect tables, other sheets are described by a text file:
+//	image <path>                          sheet the sprites come from
+//	grid <width> <height> <cols> <rows>   equal cells numbered row by row from the next free ID
+//	sprite <id> <x> <y> <width> <height> [name]  one sprite rect
+//	# comment
+//Packed atlases from atlaspack hold several sheets, sprites named <group>/<id> can be loaded by group
+class Atlas
+{
+	public:
+		//Initializes an empty atlas
+		Atlas();
+
+		//Uses a rect table indexed by sprite ID, the table is not copied
+		void setRects( const SDL_Rect* rects, int count );
+
+		//Builds clips for a grid of equal cells numbered row by row
+		void setGrid( int spriteWidth, int spriteHeight, int columns, int rows );
+
+		//Loads a descriptor file, only the sprites of a group when one is given
+		bool loadFromFile( std::string path, std::string group = "" );
+
+		//Deallocates clips
+		void free();
+
+		//Gets the clip of a sprite, an empty rect for unknown IDs
+		const SDL_Rect& getClip( int id ) { return ( id >= 0 && id < mCount ) ? mClips[ id ] : mEmpty; }
+
+		//Gets the number of sprite IDs
+		int getCount() { return mCount; }
+
+		//Gets the ID of a named sprite, -1 if there is none
+		int getId( std::string name );
+
+		//Gets the sheet named by the descriptor
+		std::string getImagePath() { return mImagePath; }
+
+	private:
+		//The clips by sprite ID
+		const SDL_Rect* mClips;
+		int mCount;
+
+		//Clip storage for grids and descriptor files
+		std::vector<SDL_Rect> mOwned;
+
+		//The sheet named by the descriptor
+		std::string mImagePath;
+
+		//IDs of named sprites
+		std::unordered_map<std::string, int> mIds;
+
+		//Returned for unknown IDs
+		SDL_Rect mEmpty;
+};
+
+#endif
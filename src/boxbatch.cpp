@@ -0,0 +1,230 @@
+#include "boxbatch.h"
+#include <string.h>
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#define BOXBATCH_X86
+#include <immintrin.h>
+#endif
+
+//Tests box against count boxes and ORs the overlaps into masks, which start zeroed
+typedef void (*OverlapKernel)( const SDL_Rect& box, const Sint32* x, const Sint32* y, const Sint32* w, const Sint32* h, int count, Uint32* masks );
+
+//Kernel for the boxes the vector kernels leave over
+static void overlapScalar( const SDL_Rect& box, const Sint32* x, const Sint32* y, const Sint32* w, const Sint32* h, int first, int count, Uint32* masks )
+{
+	int right = box.x + box.w;
+	int bottom = box.y + box.h;
+	for( int i = first; i < count; ++i )
+	{
+		//Branch free so unpredictable hits don't stall
+		Uint32 hit = ( x[ i ] + w[ i ] > box.x ) & ( right > x[ i ] ) & ( y[ i ] + h[ i ] > box.y ) & ( bottom > y[ i ] );
+		masks[ i >> 5 ] |= hit << ( i & 31 );
+	}
+}
+
+static void overlapScalar( const SDL_Rect& box, const Sint32* x, const Sint32* y, const Sint32* w, const Sint32* h, int count, Uint32* masks )
+{
+	overlapScalar( box, x, y, w, h, 0, count, masks );
+}
+
+#ifdef BOXBATCH_X86
+__attribute__(( target( "sse2" ) ))
+static void overlapSSE2( const SDL_Rect& box, const Sint32* x, const Sint32* y, const Sint32* w, const Sint32* h, int count, Uint32* masks )
+{
+	__m128i left = _mm_set1_epi32( box.x );
+	__m128i top = _mm_set1_epi32( box.y );
+	__m128i right = _mm_set1_epi32( box.x + box.w );
+	__m128i bottom = _mm_set1_epi32( box.y + box.h );
+
+	//Four boxes at a time
+	int i = 0;
+	for( ; i + 4 <= count; i += 4 )
+	{
+		__m128i bx = _mm_loadu_si128( (const __m128i*)( x + i ) );
+		__m128i by = _mm_loadu_si128( (const __m128i*)( y + i ) );
+		__m128i bRight = _mm_add_epi32( bx, _mm_loadu_si128( (const __m128i*)( w + i ) ) );
+		__m128i bBottom = _mm_add_epi32( by, _mm_loadu_si128( (const __m128i*)( h + i ) ) );
+
+		__m128i hit = _mm_and_si128( _mm_and_si128( _mm_cmpgt_epi32( bRight, left ), _mm_cmpgt_epi32( right, bx ) ),
+			_mm_and_si128( _mm_cmpgt_epi32( bBottom, top ), _mm_cmpgt_epi32( bottom, by ) ) );
+
+		//One bit per lane
+		masks[ i >> 5 ] |= (Uint32)_mm_movemask_ps( _mm_castsi128_ps( hit ) ) << ( i & 31 );
+	}
+
+	overlapScalar( box, x, y, w, h, i, count, masks );
+}
+
+__attribute__(( target( "avx2" ) ))
+static void overlapAVX2( const SDL_Rect& box, const Sint32* x, const Sint32* y, const Sint32* w, const Sint32* h, int count, Uint32* masks )
+{
+	__m256i left = _mm256_set1_epi32( box.x );
+	__m256i top = _mm256_set1_epi32( box.y );
+	__m256i right = _mm256_set1_epi32( box.x + box.w );
+	__m256i bottom = _mm256_set1_epi32( box.y + box.h );
+
+	//Eight boxes at a time
+	int i = 0;
+	for( ; i + 8 <= count; i += 8 )
+	{
+		__m256i bx = _mm256_loadu_si256( (const __m256i*)( x + i ) );
+		__m256i by = _mm256_loadu_si256( (const __m256i*)( y + i ) );
+		__m256i bRight = _mm256_add_epi32( bx, _mm256_loadu_si256( (const __m256i*)( w + i ) ) );
+		__m256i bBottom = _mm256_add_epi32( by, _mm256_loadu_si256( (const __m256i*)( h + i ) ) );
+
+		__m256i hit = _mm256_and_si256( _mm256_and_si256( _mm256_cmpgt_epi32( bRight, left ), _mm256_cmpgt_epi32( right, bx ) ),
+			_mm256_and_si256( _mm256_cmpgt_epi32( bBottom, top ), _mm256_cmpgt_epi32( bottom, by ) ) );
+
+		//One bit per lane
+		masks[ i >> 5 ] |= (Uint32)_mm256_movemask_ps( _mm256_castsi256_ps( hit ) ) << ( i & 31 );
+	}
+
+	overlapScalar( box, x, y, w, h, i, count, masks );
+}
+#endif
+
+//Kernels by BoxKernel
+static const OverlapKernel KERNELS[ BOX_KERNEL_TOTAL ] =
+{
+	overlapScalar,
+#ifdef BOXBATCH_X86
+	overlapSSE2,
+	overlapAVX2
+#else
+	NULL,
+	NULL
+#endif
+};
+
+static const char* const KERNEL_NAMES[ BOX_KERNEL_TOTAL ] = { "scalar", "sse2", "avx2" };
+
+//Kernel in use, picked on first use
+static BoxKernel gKernel = BOX_KERNEL_TOTAL;
+
+BoxBatch::BoxBatch()
+{
+}
+
+void BoxBatch::clear()
+{
+	mX.clear();
+	mY.clear();
+	mW.clear();
+	mH.clear();
+}
+
+void BoxBatch::add( const SDL_Rect& box )
+{
+	mX.push_back( box.x );
+	mY.push_back( box.y );
+	mW.push_back( box.w );
+	mH.push_back( box.h );
+}
+
+SDL_Rect BoxBatch::get( int index )
+{
+	SDL_Rect box = { mX[ index ], mY[ index ], mW[ index ], mH[ index ] };
+	return box;
+}
+
+void BoxBatch::set( int index, const SDL_Rect& box )
+{
+	mX[ index ] = box.x;
+	mY[ index ] = box.y;
+	mW[ index ] = box.w;
+	mH[ index ] = box.h;
+}
+
+void BoxBatch::remove( int index )
+{
+	set( index, get( getCount() - 1 ) );
+	mX.pop_back();
+	mY.pop_back();
+	mW.pop_back();
+	mH.pop_back();
+}
+
+int BoxBatch::testOverlaps( const SDL_Rect& box, Uint32* masks )
+{
+	if( gKernel == BOX_KERNEL_TOTAL )
+	{
+		selectKernel();
+	}
+
+	int words = getMaskWords();
+	if( words == 0 )
+	{
+		return 0;
+	}
+	memset( masks, 0, words * sizeof( Uint32 ) );
+	KERNELS[ gKernel ]( box, &mX[ 0 ], &mY[ 0 ], &mW[ 0 ], &mH[ 0 ], getCount(), masks );
+
+	//Count the hits
+	int overlaps = 0;
+	for( int i = 0; i < words; ++i )
+	{
+		overlaps += __builtin_popcount( masks[ i ] );
+	}
+	return overlaps;
+}
+
+int BoxBatch::findOverlaps( const SDL_Rect& box, std::vector<int>& hits )
+{
+	hits.clear();
+	mMasks.resize( getMaskWords() );
+	if( testOverlaps( box, mMasks.empty() ? NULL : &mMasks[ 0 ] ) == 0 )
+	{
+		return 0;
+	}
+
+	//Walk the set bits
+	for( size_t i = 0; i < mMasks.size(); ++i )
+	{
+		for( Uint32 mask = mMasks[ i ]; mask != 0; mask &= mask - 1 )
+		{
+			hits.push_back( (int)i * 32 + __builtin_ctz( mask ) );
+		}
+	}
+	return (int)hits.size();
+}
+
+void BoxBatch::selectKernel()
+{
+	if( !useKernel( BOX_KERNEL_AVX2 ) && !useKernel( BOX_KERNEL_SSE2 ) )
+	{
+		useKernel( BOX_KERNEL_SCALAR );
+	}
+}
+
+bool BoxBatch::useKernel( BoxKernel kernel )
+{
+	//The vector kernels need both the build and the CPU to have them
+	bool supported;
+	switch( kernel )
+	{
+		case BOX_KERNEL_SCALAR: supported = true; break;
+		case BOX_KERNEL_SSE2: supported = KERNELS[ kernel ] != NULL && SDL_HasSSE2(); break;
+		case BOX_KERNEL_AVX2: supported = KERNELS[ kernel ] != NULL && SDL_HasAVX2(); break;
+		default: supported = false; break;
+	}
+
+	if( supported )
+	{
+		gKernel = kernel;
+	}
+	return supported;
+}
+
+BoxKernel BoxBatch::getKernel()
+{
+	if( gKernel == BOX_KERNEL_TOTAL )
+	{
+		selectKernel();
+	}
+	return gKernel;
+}
+
+const char* BoxBatch::getKernelName( BoxKernel kernel )
+{
+	return kernel >= 0 && kernel < BOX_KERNEL_TOTAL ? KERNEL_NAMES[ kernel ] : "none";
+}
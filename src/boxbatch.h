@@ -0,0 +1,79 @@
+#ifndef BOXBATCH_H
+#define BOXBATCH_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+//Overlap test implementations
+enum BoxKernel
+{
+	BOX_KERNEL_SCALAR,
+	BOX_KERNEL_SSE2,
+	BOX_KERNEL_AVX2,
+	BOX_KERNEL_TOTAL
+};
+
+//Boxes stored as separate x, y, w and h arrays so one box can be tested against many at once
+//Overlap follows checkCollision, boxes that only share an edge don't overlap
+class BoxBatch
+{
+	public:
+		//Initializes an empty batch
+		BoxBatch();
+
+		//Removes every box
+		void clear();
+
+		//Adds a box, its index is the number of boxes before it
+		void add( const SDL_Rect& box );
+
+		//Gets a box back
+		SDL_Rect get( int index );
+
+		//Replaces a box
+		void set( int index, const SDL_Rect& box );
+
+		//Removes a box by moving the last box into its place
+		void remove( int index );
+
+		//Gets the box arrays, for systems that update boxes in place
+		Sint32* getX() { return mX.empty() ? NULL : &mX[ 0 ]; }
+		Sint32* getY() { return mY.empty() ? NULL : &mY[ 0 ]; }
+		Sint32* getW() { return mW.empty() ? NULL : &mW[ 0 ]; }
+		Sint32* getH() { return mH.empty() ? NULL : &mH[ 0 ]; }
+
+		//Gets the number of boxes
+		int getCount() { return (int)mX.size(); }
+
+		//Tests a box against every box, setting bit index % 32 of masks[ index / 32 ] for each overlap
+		//masks needs getMaskWords() words, returns the overlaps found
+		int testOverlaps( const SDL_Rect& box, Uint32* masks );
+
+		//Lists the indices of the boxes a box overlaps, returns the overlaps found
+		int findOverlaps( const SDL_Rect& box, std::vector<int>& hits );
+
+		//Gets the words of overlap mask the batch needs
+		int getMaskWords() { return ( getCount() + 31 ) / 32; }
+
+		//Picks the fastest kernel the CPU supports, done on first use
+		static void selectKernel();
+
+		//Forces a kernel, false if the CPU or build doesn't support it
+		static bool useKernel( BoxKernel kernel );
+
+		//Gets the kernel in use and kernel names
+		static BoxKernel getKernel();
+		static const char* getKernelName( BoxKernel kernel );
+
+	private:
+		//The box arrays
+		std::vector<Sint32> mX;
+		std::vector<Sint32> mY;
+		std::vector<Sint32> mW;
+		std::vector<Sint32> mH;
+
+		//Masks for findOverlaps
+		std::vector<Uint32> mMasks;
+};
+
+#endif
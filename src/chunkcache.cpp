@@ -0,0 +1,216 @@
+#include "chunkcache.h"
+#include "trace.h"
+#include <stdio.h>
+
+ChunkCache::ChunkCache()
+{
+	//Initialize
+	mRenderer = NULL;
+	mColumns = 0;
+	mRows = 0;
+}
+
+ChunkCache::~ChunkCache()
+{
+	//Deallocate
+	free();
+}
+
+bool ChunkCache::init( SDL_Renderer* renderer, Level& level )
+{
+	//Get rid of preexisting chunks
+	free();
+
+	//Chunks need render targets
+	if( !SDL_RenderTargetSupported( renderer ) )
+	{
+		printf( "Warning: Render targets not supported, chunk cache disabled!\n" );
+		return false;
+	}
+
+	//Cover the level, with partial chunks at the far edges
+	mRenderer = renderer;
+	mColumns = ( level.getColumns() + CHUNK_TILES - 1 ) / CHUNK_TILES;
+	mRows = ( level.getRows() + CHUNK_TILES - 1 ) / CHUNK_TILES;
+
+	Chunk empty = { NULL, true };
+	mChunks.assign( mColumns * mRows, empty );
+
+	return true;
+}
+
+void ChunkCache::free()
+{
+	releaseTextures();
+	mChunks.clear();
+	mRenderer = NULL;
+	mColumns = 0;
+	mRows = 0;
+}
+
+void ChunkCache::invalidateTile( int col, int row )
+{
+	int chunkCol = col / CHUNK_TILES;
+	int chunkRow = row / CHUNK_TILES;
+	if( chunkCol >= 0 && chunkCol < mColumns && chunkRow >= 0 && chunkRow < mRows )
+	{
+		mChunks[ chunkRow * mColumns + chunkCol ].dirty = true;
+	}
+}
+
+void ChunkCache::invalidateArea( int firstCol, int firstRow, int lastCol, int lastRow )
+{
+	//Clamp to the chunk grid
+	int firstChunkCol = SDL_max( firstCol / CHUNK_TILES, 0 );
+	int firstChunkRow = SDL_max( firstRow / CHUNK_TILES, 0 );
+	int lastChunkCol = SDL_min( lastCol / CHUNK_TILES, mColumns - 1 );
+	int lastChunkRow = SDL_min( lastRow / CHUNK_TILES, mRows - 1 );
+
+	for( int chunkRow = firstChunkRow; chunkRow <= lastChunkRow; ++chunkRow )
+	{
+		for( int chunkCol = firstChunkCol; chunkCol <= lastChunkCol; ++chunkCol )
+		{
+			mChunks[ chunkRow * mColumns + chunkCol ].dirty = true;
+		}
+	}
+}
+
+void ChunkCache::invalidateAll()
+{
+	for( size_t i = 0; i < mChunks.size(); ++i )
+	{
+		mChunks[ i ].dirty = true;
+	}
+}
+
+void ChunkCache::releaseTextures()
+{
+	for( size_t i = 0; i < mBaked.size(); ++i )
+	{
+		SDL_DestroyTexture( mChunks[ mBaked[ i ] ].texture );
+		mChunks[ mBaked[ i ] ].texture = NULL;
+	}
+	mBaked.clear();
+
+	invalidateAll();
+}
+
+void ChunkCache::releaseOutside( int firstCol, int firstRow, int lastCol, int lastRow )
+{
+	for( size_t i = 0; i < mBaked.size(); )
+	{
+		int chunkCol = mBaked[ i ] % mColumns;
+		int chunkRow = mBaked[ i ] / mColumns;
+		if( chunkCol < firstCol - 1 || chunkCol > lastCol + 1 || chunkRow < firstRow - 1 || chunkRow > lastRow + 1 )
+		{
+			SDL_DestroyTexture( mChunks[ mBaked[ i ] ].texture );
+			mChunks[ mBaked[ i ] ].texture = NULL;
+			mChunks[ mBaked[ i ] ].dirty = true;
+
+			//Order doesn't matter, so fill the gap from the back
+			mBaked[ i ] = mBaked.back();
+			mBaked.pop_back();
+		}
+		else
+		{
+			++i;
+		}
+	}
+}
+
+int ChunkCache::render( Level& level, SDL_Rect& camera, SDL_Texture* sheet, int sheetWidth, int sheetHeight, Atlas& atlas )
+{
+	//Get the tiles under the camera
+	int firstCol, firstRow, lastCol, lastRow;
+	if( !level.getTileSpan( camera, firstCol, firstRow, lastCol, lastRow ) )
+	{
+		return 0;
+	}
+
+	//Show each chunk those tiles fall in
+	int drawCalls = 0;
+	for( int chunkRow = firstRow / CHUNK_TILES; chunkRow <= lastRow / CHUNK_TILES; ++chunkRow )
+	{
+		for( int chunkCol = firstCol / CHUNK_TILES; chunkCol <= lastCol / CHUNK_TILES; ++chunkCol )
+		{
+			Chunk& chunk = mChunks[ chunkRow * mColumns + chunkCol ];
+
+			//Rebake chunks that are missing or out of date
+			if( chunk.dirty || chunk.texture == NULL )
+			{
+				drawCalls += bake( chunkCol, chunkRow, level, sheet, sheetWidth, sheetHeight, atlas );
+			}
+
+			if( chunk.texture != NULL )
+			{
+				int width, height;
+				SDL_QueryTexture( chunk.texture, NULL, NULL, &width, &height );
+
+				SDL_Rect dest = { chunkCol * CHUNK_TILES * TILE_WIDTH - camera.x, chunkRow * CHUNK_TILES * TILE_HEIGHT - camera.y, width, height };
+				SDL_RenderCopy( mRenderer, chunk.texture, NULL, &dest );
+				drawCalls++;
+			}
+		}
+	}
+
+	//A chunk texture is over a megabyte, so don't keep ones left behind
+	releaseOutside( firstCol / CHUNK_TILES, firstRow / CHUNK_TILES, lastCol / CHUNK_TILES, lastRow / CHUNK_TILES );
+
+	return drawCalls;
+}
+
+int ChunkCache::bake( int chunkCol, int chunkRow, Level& level, SDL_Texture* sheet, int sheetWidth, int sheetHeight, Atlas& atlas )
+{
+	TRACE_SCOPE( "ChunkCache::bake" );
+
+	Chunk& chunk = mChunks[ chunkRow * mColumns + chunkCol ];
+
+	//The tiles in this chunk
+	int firstCol = chunkCol * CHUNK_TILES;
+	int firstRow = chunkRow * CHUNK_TILES;
+	int columns = SDL_min( CHUNK_TILES, level.getColumns() - firstCol );
+	int rows = SDL_min( CHUNK_TILES, level.getRows() - firstRow );
+
+	//Create the target texture the first time around
+	if( chunk.texture == NULL )
+	{
+		chunk.texture = SDL_CreateTexture( mRenderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, columns * TILE_WIDTH, rows * TILE_HEIGHT );
+		if( chunk.texture == NULL )
+		{
+			printf( "Unable to create chunk texture! SDL Error: %s\n", SDL_GetError() );
+			return 0;
+		}
+
+		//The chunk already holds the background, so copy it as is
+		SDL_SetTextureBlendMode( chunk.texture, SDL_BLENDMODE_NONE );
+		mBaked.push_back( chunkRow * mColumns + chunkCol );
+	}
+
+	//Render the tiles over the same background as the screen
+	SDL_SetRenderTarget( mRenderer, chunk.texture );
+	SDL_SetRenderDrawColor( mRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
+	SDL_RenderClear( mRenderer );
+
+	mBatch.clear();
+	for( int row = 0; row < rows; ++row )
+	{
+		for( int col = 0; col < columns; )
+		{
+			//Tiles of a run share the clip
+			int end;
+			const SDL_Rect& clip = atlas.getClip( level.getRun( firstCol + col, firstRow + row, end ) );
+			for( end = SDL_min( end - firstCol, columns ); col < end; ++col )
+			{
+				SDL_Rect dest = { col * TILE_WIDTH, row * TILE_HEIGHT, TILE_WIDTH, TILE_HEIGHT };
+				mBatch.add( clip, dest );
+			}
+		}
+	}
+	int drawCalls = mBatch.draw( mRenderer, sheet, sheetWidth, sheetHeight );
+
+	//Back to the screen
+	SDL_SetRenderTarget( mRenderer, NULL );
+	chunk.dirty = false;
+
+	return drawCalls;
+}
@@ -0,0 +1,78 @@
+#ifndef CHUNKCACHE_H
+#define CHUNKCACHE_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+#include "level.h"
+#include "tilebatch.h"
+#include "atlas.h"
+
+//Chunk size in tiles
+const int CHUNK_TILES = 16;
+
+//Caches square blocks of the level as prerendered textures
+class ChunkCache
+{
+	public:
+		//Initializes variables
+		ChunkCache();
+
+		//Deallocates chunk textures
+		~ChunkCache();
+
+		//Sets up the chunk grid for a level, false if the renderer can't render to textures
+		bool init( SDL_Renderer* renderer, Level& level );
+
+		//Deallocates chunk textures
+		void free();
+
+		//Marks the chunk holding a tile for rebaking
+		void invalidateTile( int col, int row );
+
+		//Marks the chunks overlapping a tile area for rebaking, as when streamed tiles arrive
+		void invalidateArea( int firstCol, int firstRow, int lastCol, int lastRow );
+
+		//Marks every chunk for rebaking, as when render targets are reset
+		void invalidateAll();
+
+		//Drops every chunk texture, as when the render device is lost
+		void releaseTextures();
+
+		//Draws the chunks under the camera and returns the draw calls used, dropping textures of chunks well off screen
+		int render( Level& level, SDL_Rect& camera, SDL_Texture* sheet, int sheetWidth, int sheetHeight, Atlas& atlas );
+
+		//Whether chunks are in use
+		bool isEnabled() { return mRenderer != NULL; }
+
+	private:
+		//A prerendered block of tiles
+		struct Chunk
+		{
+			SDL_Texture* texture;
+			bool dirty;
+		};
+
+		//Drops the textures of baked chunks more than a chunk outside a chunk span
+		void releaseOutside( int firstCol, int firstRow, int lastCol, int lastRow );
+
+		//Renders the tiles of a chunk into its texture, returns the draw calls used
+		int bake( int chunkCol, int chunkRow, Level& level, SDL_Texture* sheet, int sheetWidth, int sheetHeight, Atlas& atlas );
+
+		//The renderer the chunks belong to
+		SDL_Renderer* mRenderer;
+
+		//The chunks, row by row
+		std::vector<Chunk> mChunks;
+
+		//Chunks holding textures, so large worlds don't keep every chunk they pass
+		std::vector<int> mBaked;
+
+		//Chunk grid dimensions
+		int mColumns;
+		int mRows;
+
+		//Tiles queued while baking
+		TileBatch mBatch;
+};
+
+#endif
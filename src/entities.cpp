@@ -0,0 +1,336 @@
+#include "entities.h"
+#include <stdio.h>
+#include <math.h>
+
+//Moves the last element of a component array into a removed slot
+template<typename T>
+static void removeSlot( std::vector<T>& components, Uint32 slot )
+{
+	components[ slot ] = components.back();
+	components.pop_back();
+}
+
+EntityWorld::EntityWorld()
+{
+}
+
+EntityId EntityWorld::create( const SDL_Rect& box, const EntityLook* look, int facing, Uint8 flags )
+{
+	//Reuse a handle if one is free
+	Uint32 index;
+	if( !mFreeIds.empty() )
+	{
+		index = mFreeIds.back();
+		mFreeIds.pop_back();
+	}
+	else
+	{
+		//Any more and the slot lookup would run into the generation bits
+		if( mSlots.size() >= ENTITY_INDEX_MASK )
+		{
+			printf( "Unable to create entity! Out of handles, at most %u can exist at once.\n", ENTITY_INDEX_MASK );
+			return ENTITY_NONE;
+		}
+
+		index = (Uint32)mSlots.size();
+		mSlots.push_back( 0 );
+		mGenerations.push_back( 0 );
+	}
+	EntityId entity = ( mGenerations[ index ] << ENTITY_INDEX_BITS ) | index;
+
+	//Add to the end of every array
+	mSlots[ index ] = (Uint32)mIds.size();
+	mIds.push_back( entity );
+	mBoxes.add( box );
+	mPrevX.push_back( box.x );
+	mPrevY.push_back( box.y );
+	mVelX.push_back( 0 );
+	mVelY.push_back( 0 );
+	mRemX.push_back( 0 );
+	mRemY.push_back( 0 );
+	mFacing.push_back( (Uint8)facing );
+	mFlags.push_back( flags );
+	mLooks.push_back( look );
+
+	//Start out standing
+	mAnimations.push_back( Animation() );
+	mAnimations.back().play( &look->stand[ facing ] );
+
+	return entity;
+}
+
+void EntityWorld::destroy( EntityId entity )
+{
+	//Already gone, or the handle has been given out again since
+	if( !isAlive( entity ) )
+	{
+		return;
+	}
+
+	//Fill the gap with the last entity
+	Uint32 index = entity & ENTITY_INDEX_MASK;
+	Uint32 slot = mSlots[ index ];
+	mSlots[ mIds.back() & ENTITY_INDEX_MASK ] = slot;
+	removeSlot( mIds, slot );
+	mBoxes.remove( slot );
+	removeSlot( mPrevX, slot );
+	removeSlot( mPrevY, slot );
+	removeSlot( mVelX, slot );
+	removeSlot( mVelY, slot );
+	removeSlot( mRemX, slot );
+	removeSlot( mRemY, slot );
+	removeSlot( mFacing, slot );
+	removeSlot( mFlags, slot );
+	removeSlot( mAnimations, slot );
+	removeSlot( mLooks, slot );
+
+	//Handles given out for this index from now on won't match the old one
+	mGenerations[ index ] = ( mGenerations[ index ] + 1 ) & ( 0xFFFFFFFFu >> ENTITY_INDEX_BITS );
+	mFreeIds.push_back( index );
+}
+
+void EntityWorld::clear()
+{
+	mSlots.clear();
+	mIds.clear();
+	mFreeIds.clear();
+	mGenerations.clear();
+	mBoxes.clear();
+	mPrevX.clear();
+	mPrevY.clear();
+	mVelX.clear();
+	mVelY.clear();
+	mRemX.clear();
+	mRemY.clear();
+	mFacing.clear();
+	mFlags.clear();
+	mAnimations.clear();
+	mLooks.clear();
+}
+
+void EntityWorld::setBox( EntityId entity, const SDL_Rect& box )
+{
+	Uint32 slot = mSlots[ entity & ENTITY_INDEX_MASK ];
+	mBoxes.set( slot, box );
+	mPrevX[ slot ] = box.x;
+	mPrevY[ slot ] = box.y;
+}
+
+void EntityWorld::setVelocity( EntityId entity, int velX, int velY )
+{
+	Uint32 slot = mSlots[ entity & ENTITY_INDEX_MASK ];
+	mVelX[ slot ] = velX;
+	mVelY[ slot ] = velY;
+}
+
+void EntityWorld::savePositions()
+{
+	int count = getCount();
+	const Sint32* x = mBoxes.getX();
+	const Sint32* y = mBoxes.getY();
+	for( int i = 0; i < count; ++i )
+	{
+		mPrevX[ i ] = x[ i ];
+		mPrevY[ i ] = y[ i ];
+	}
+}
+
+void EntityWorld::move( Level& level, int tickRate )
+{
+	moveRange( level, tickRate, 0, getCount() );
+}
+
+void EntityWorld::moveRange( Level& level, int tickRate, int first, int last )
+{
+	Sint32* x = mBoxes.getX();
+	Sint32* y = mBoxes.getY();
+	const Sint32* w = mBoxes.getW();
+	const Sint32* h = mBoxes.getH();
+	for( int i = first; i < last; ++i )
+	{
+		//Velocity is per second, so carry over what doesn't add up to a whole pixel
+		mRemX[ i ] = mVelX[ i ] == 0 ? 0 : mRemX[ i ] + mVelX[ i ];
+		mRemY[ i ] = mVelY[ i ] == 0 ? 0 : mRemY[ i ] + mVelY[ i ];
+		int stepX = mRemX[ i ] / tickRate;
+		int stepY = mRemY[ i ] / tickRate;
+		mRemX[ i ] -= stepX * tickRate;
+		mRemY[ i ] -= stepY * tickRate;
+
+		//Sweep across the tiles, sliding along whatever is in the way
+		SDL_Rect box = { x[ i ], y[ i ], w[ i ], h[ i ] };
+		TileHit hit;
+		if( level.sweep( box, stepX, stepY, hit ) )
+		{
+			if( hit.normalX != 0 )
+			{
+				mRemX[ i ] = 0;
+				if( mFlags[ i ] & ENTITY_BOUNCE )
+				{
+					mVelX[ i ] = -mVelX[ i ];
+				}
+			}
+			if( hit.normalY != 0 )
+			{
+				mRemY[ i ] = 0;
+				if( mFlags[ i ] & ENTITY_BOUNCE )
+				{
+					mVelY[ i ] = -mVelY[ i ];
+				}
+			}
+		}
+		x[ i ] = box.x;
+		y[ i ] = box.y;
+	}
+}
+
+void EntityWorld::updateGrid( int parts )
+{
+	mGrid.build( mBoxes );
+	mPairs.resize( SDL_max( parts, 1 ) );
+}
+
+int EntityWorld::findPairs( std::vector<EntityPair>& pairs )
+{
+	return findPairs( pairs, 0, 1 );
+}
+
+int EntityWorld::findPairs( std::vector<EntityPair>& pairs, int part, int parts )
+{
+	//Each part gets an even share of the buckets
+	Sint64 buckets = mGrid.getBucketCount();
+	std::vector<BoxPair>& found = mPairs[ part ];
+	mGrid.findPairs( mBoxes, found, (Uint32)( buckets * part / parts ), (Uint32)( buckets * ( part + 1 ) / parts ) );
+
+	//Slots to handles
+	pairs.resize( found.size() );
+	for( size_t i = 0; i < found.size(); ++i )
+	{
+		pairs[ i ].a = mIds[ found[ i ].a ];
+		pairs[ i ].b = mIds[ found[ i ].b ];
+	}
+	return (int)pairs.size();
+}
+
+int EntityWorld::query( const SDL_Rect& area, std::vector<EntityId>& hits )
+{
+	mGrid.query( mBoxes, area, mHits );
+
+	hits.resize( mHits.size() );
+	for( size_t i = 0; i < mHits.size(); ++i )
+	{
+		hits[ i ] = mIds[ mHits[ i ] ];
+	}
+	return (int)hits.size();
+}
+
+void EntityWorld::animate( Uint32 elapsed )
+{
+	animateRange( elapsed, 0, getCount() );
+}
+
+void EntityWorld::animateRange( Uint32 elapsed, int first, int last )
+{
+	for( int i = first; i < last; ++i )
+	{
+		int velX = mVelX[ i ];
+		int velY = mVelY[ i ];
+
+		//Face the way the entity is heading, moving on both axes keeps the current facing
+		if( velX == 0 || velY == 0 )
+		{
+			if( velY < 0 )
+			{
+				mFacing[ i ] = FACING_UP;
+			}
+			else if( velY > 0 )
+			{
+				mFacing[ i ] = FACING_DOWN;
+			}
+			else if( velX < 0 )
+			{
+				mFacing[ i ] = FACING_LEFT;
+			}
+			else if( velX > 0 )
+			{
+				mFacing[ i ] = FACING_RIGHT;
+			}
+		}
+
+		//Walk while moving, stand still otherwise
+		if( velX != 0 || velY != 0 )
+		{
+			mAnimations[ i ].play( &mLooks[ i ]->walk[ mFacing[ i ] ] );
+		}
+		else
+		{
+			mAnimations[ i ].play( &mLooks[ i ]->stand[ mFacing[ i ] ] );
+		}
+		mAnimations[ i ].update( elapsed );
+	}
+}
+
+void EntityWorld::steerRange( const FlowField& field, int speed, int first, int last )
+{
+	const Sint32* x = mBoxes.getX();
+	const Sint32* y = mBoxes.getY();
+	const Sint32* w = mBoxes.getW();
+	const Sint32* h = mBoxes.getH();
+	for( int i = first; i < last; ++i )
+	{
+		if( !( mFlags[ i ] & ENTITY_SEEK ) )
+		{
+			continue;
+		}
+
+		//The tile under the middle of the box and the next one along the field, the goal is its own next tile
+		int centerX = x[ i ] + w[ i ] / 2;
+		int centerY = y[ i ] + h[ i ] / 2;
+		int col = centerX / TILE_WIDTH;
+		int row = centerY / TILE_HEIGHT;
+		int direction = field.directions[ row * field.columns + col ];
+		if( direction != FLOW_NONE )
+		{
+			col += FLOW_STEPS[ direction ][ 0 ];
+			row += FLOW_STEPS[ direction ][ 1 ];
+		}
+
+		//Head for its middle on both axes
+		int toX = col * TILE_WIDTH + TILE_WIDTH / 2 - centerX;
+		int toY = row * TILE_HEIGHT + TILE_HEIGHT / 2 - centerY;
+		mVelX[ i ] = toX > ENTITY_SEEK_SLACK ? speed : ( toX < -ENTITY_SEEK_SLACK ? -speed : 0 );
+		mVelY[ i ] = toY > ENTITY_SEEK_SLACK ? speed : ( toY < -ENTITY_SEEK_SLACK ? -speed : 0 );
+	}
+}
+
+int EntityWorld::render( SDL_Renderer* renderer, SDL_Rect& camera, float alpha, SDL_Texture* sheet, int sheetWidth, int sheetHeight, Atlas& atlas )
+{
+	//Find the entities under the camera, with a margin for the movement blended in
+	SDL_Rect area = { camera.x - ENTITY_CULL_MARGIN, camera.y - ENTITY_CULL_MARGIN, camera.w + ENTITY_CULL_MARGIN * 2, camera.h + ENTITY_CULL_MARGIN * 2 };
+	mVisible.resize( mBoxes.getMaskWords() );
+	if( mVisible.empty() || mBoxes.testOverlaps( area, &mVisible[ 0 ] ) == 0 )
+	{
+		return 0;
+	}
+
+	//Queue them all from the one sheet
+	const Sint32* x = mBoxes.getX();
+	const Sint32* y = mBoxes.getY();
+	mBatch.clear();
+	for( size_t word = 0; word < mVisible.size(); ++word )
+	{
+		for( Uint32 mask = mVisible[ word ]; mask != 0; mask &= mask - 1 )
+		{
+			int i = (int)word * 32 + __builtin_ctz( mask );
+
+			//Blend between the last two simulated positions
+			int drawX = mPrevX[ i ] + (int)lroundf( ( x[ i ] - mPrevX[ i ] ) * alpha );
+			int drawY = mPrevY[ i ] + (int)lroundf( ( y[ i ] - mPrevY[ i ] ) * alpha );
+
+			const SDL_Rect& clip = atlas.getClip( mAnimations[ i ].getSprite() );
+			SDL_Rect dest = { drawX - camera.x, drawY - camera.y, clip.w, clip.h };
+			mBatch.add( clip, dest );
+		}
+	}
+
+	return mBatch.draw( renderer, sheet, sheetWidth, sheetHeight );
+}
@@ -0,0 +1,167 @@
+#ifndef ENTITIES_H
+#define ENTITIES_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+#include "level.h"
+#include "animation.h"
+#include "atlas.h"
+#include "tilebatch.h"
+#include "boxbatch.h"
+#include "spatialhash.h"
+#include "pathfinder.h"
+
+//Facing, in sheet order, indexes the clips of a look
+const int FACING_UP = 0;
+const int FACING_LEFT = 1;
+const int FACING_RIGHT = 2;
+const int FACING_DOWN = 3;
+
+//Screen pixels past the camera that entities are still drawn in, covers a tick of movement
+const int ENTITY_CULL_MARGIN = 32;
+
+//Entity behaviour flags
+const Uint8 ENTITY_BOUNCE = 1;
+const Uint8 ENTITY_SEEK = 2;
+
+//Pixels off a tile's middle a seeking entity still counts as on it
+const int ENTITY_SEEK_SLACK = 2;
+
+//Handle to an entity, stays valid while other entities come and go
+//The low bits pick the handle's slot lookup and the high bits count how many times it was reused, so old handles go stale
+typedef Uint32 EntityId;
+
+//Bits of a handle used for the slot lookup, the rest hold the generation
+const int ENTITY_INDEX_BITS = 20;
+const Uint32 ENTITY_INDEX_MASK = ( 1u << ENTITY_INDEX_BITS ) - 1;
+
+//Handle create gives back when every slot lookup is taken, its lookup is never given out so it's never alive
+const EntityId ENTITY_NONE = 0xFFFFFFFFu;
+
+//Two entities that may be touching
+struct EntityPair
+{
+	EntityId a;
+	EntityId b;
+};
+
+//How a kind of entity looks, standing and walking clips by facing
+struct EntityLook
+{
+	const AnimationClip* stand;
+	const AnimationClip* walk;
+};
+
+//Moving sprites, the player and everything else that walks around
+//Each component lives in its own array and each system walks the arrays front to back,
+//so thousands of entities update without chasing pointers
+class EntityWorld
+{
+	public:
+		//Initializes an empty world
+		EntityWorld();
+
+		//Adds an entity with its collision box, looking the given way, ENTITY_NONE once there are no more handles
+		EntityId create( const SDL_Rect& box, const EntityLook* look, int facing, Uint8 flags = 0 );
+
+		//Removes an entity, stale handles and ones already removed are ignored
+		void destroy( EntityId entity );
+
+		//Whether a handle still refers to an entity
+		bool isAlive( EntityId entity )
+		{
+			Uint32 index = entity & ENTITY_INDEX_MASK;
+			return index < mSlots.size() && mSlots[ index ] < mIds.size() && mIds[ mSlots[ index ] ] == entity;
+		}
+
+		//Removes every entity
+		void clear();
+
+		//Gets and sets an entity's collision box
+		SDL_Rect getBox( EntityId entity ) { return mBoxes.get( mSlots[ entity & ENTITY_INDEX_MASK ] ); }
+		void setBox( EntityId entity, const SDL_Rect& box );
+
+		//Sets an entity's velocity in pixels per second
+		void setVelocity( EntityId entity, int velX, int velY );
+
+		//Gets the number of entities
+		int getCount() { return mBoxes.getCount(); }
+
+		//Remembers where entities were before a simulation tick
+		void savePositions();
+
+		//Moves entities by one tick, sweeping them across the tiles so they stop flush against the level edges and walls
+		void move( Level& level, int tickRate );
+
+		//Moves entities in slots first to last - 1, which touches no other slots so ranges can move in parallel
+		void moveRange( Level& level, int tickRate, int first, int last );
+
+		//Files the entities in the broad phase grid, after they move and before pairs or queries
+		//Pairs can then be found in as many parts as asked for
+		void updateGrid( int parts = 1 );
+
+		//Lists the pairs of entities close enough to touch, each once, returns the pairs found
+		int findPairs( std::vector<EntityPair>& pairs );
+
+		//Lists one part of the pairs, parts can be found in parallel and joined in order to get every pair
+		int findPairs( std::vector<EntityPair>& pairs, int part, int parts );
+
+		//Lists the entities overlapping an area, returns the entities found
+		int query( const SDL_Rect& area, std::vector<EntityId>& hits );
+
+		//Gets the broad phase grid
+		SpatialHash& getGrid() { return mGrid; }
+
+		//Turns entities the way they head and advances their animations by elapsed milliseconds
+		void animate( Uint32 elapsed );
+
+		//Animates entities in slots first to last - 1, ranges can be animated in parallel
+		void animateRange( Uint32 elapsed, int first, int last );
+
+		//Points the seeking entities in slots first to last - 1 along a flow field at the given speed,
+		//for the middle of the next tile so their boxes stay clear of the corners on the way
+		void steerRange( const FlowField& field, int speed, int first, int last );
+
+		//Draws the entities under the camera alpha of the way from their last positions, all from one sheet
+		//Returns the draw calls used
+		int render( SDL_Renderer* renderer, SDL_Rect& camera, float alpha, SDL_Texture* sheet, int sheetWidth, int sheetHeight, Atlas& atlas );
+
+	private:
+		//Handle to array slot and back, and the generation of each handle
+		std::vector<Uint32> mSlots;
+		std::vector<EntityId> mIds;
+		std::vector<Uint32> mFreeIds;
+		std::vector<Uint32> mGenerations;
+
+		//Collision boxes, which hold the positions
+		BoxBatch mBoxes;
+
+		//Positions before the last tick
+		std::vector<Sint32> mPrevX;
+		std::vector<Sint32> mPrevY;
+
+		//Velocities in pixels per second, and pixel fractions left over from the last tick in pixels * tick rate
+		std::vector<Sint32> mVelX;
+		std::vector<Sint32> mVelY;
+		std::vector<Sint32> mRemX;
+		std::vector<Sint32> mRemY;
+
+		//Direction last walked in and behaviour flags
+		std::vector<Uint8> mFacing;
+		std::vector<Uint8> mFlags;
+
+		//Animations and the looks they play
+		std::vector<Animation> mAnimations;
+		std::vector<const EntityLook*> mLooks;
+
+		//Broad phase grid over the collision boxes, and its results by slot, pairs by part
+		SpatialHash mGrid;
+		std::vector< std::vector<BoxPair> > mPairs;
+		std::vector<int> mHits;
+
+		//Culling results and sprites queued for drawing
+		std::vector<Uint32> mVisible;
+		TileBatch mBatch;
+};
+
+#endif
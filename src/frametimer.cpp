@@ -0,0 +1,191 @@
+#include "frametimer.h"
+#include <string.h>
+#include <algorithm>
+
+//Phase names for the CSV header
+static const char* PHASE_NAMES[ TOTAL_PHASES ] = { "events", "update", "level", "player", "present" };
+
+//Graph colors for each phase
+static const SDL_Color PHASE_COLORS[ TOTAL_PHASES ] =
+{
+	{ 0x40, 0x80, 0xFF, 0xFF },
+	{ 0x40, 0xD0, 0x40, 0xFF },
+	{ 0xFF, 0xC0, 0x20, 0xFF },
+	{ 0xE0, 0x40, 0xE0, 0xFF },
+	{ 0xFF, 0x40, 0x40, 0xFF }
+};
+
+//Milliseconds shown by the full graph height
+static const double GRAPH_MS = 1000.0 / 30;
+
+FrameTimer::FrameTimer()
+{
+	//Initialize
+	memset( mFrames, 0, sizeof( mFrames ) );
+	memset( &mCurrent, 0, sizeof( mCurrent ) );
+	mNext = 0;
+	mStored = 0;
+	mFrameStart = 0;
+	mFrameCount = 0;
+	mCounterMs = 0;
+	mCsv = NULL;
+	mOverlayShown = false;
+}
+
+FrameTimer::~FrameTimer()
+{
+	closeCsv();
+}
+
+void FrameTimer::beginFrame()
+{
+	memset( &mCurrent, 0, sizeof( mCurrent ) );
+	mFrameStart = SDL_GetPerformanceCounter();
+}
+
+void FrameTimer::add( int phase, Uint64 elapsed )
+{
+	mCurrent.phases[ phase ] += elapsed;
+}
+
+void FrameTimer::endFrame()
+{
+	mCurrent.total = SDL_GetPerformanceCounter() - mFrameStart;
+
+	//Keep the frame, replacing the oldest
+	mFrames[ mNext ] = mCurrent;
+	mNext = ( mNext + 1 ) % FRAME_HISTORY;
+	if( mStored < FRAME_HISTORY )
+	{
+		mStored++;
+	}
+
+	//Write the frame out
+	if( mCsv != NULL )
+	{
+		fprintf( mCsv, "%llu", (unsigned long long)mFrameCount );
+		for( int i = 0; i <= TOTAL_PHASES; ++i )
+		{
+			fprintf( mCsv, ",%.4f", getMilliseconds( mCurrent, i ) );
+		}
+		fprintf( mCsv, "\n" );
+	}
+
+	mFrameCount++;
+}
+
+bool FrameTimer::openCsv( const char* path )
+{
+	closeCsv();
+
+	mCsv = fopen( path, "w" );
+	if( mCsv == NULL )
+	{
+		printf( "Unable to open frame timing file %s!\n", path );
+		return false;
+	}
+
+	//Header row
+	fprintf( mCsv, "frame" );
+	for( int i = 0; i < TOTAL_PHASES; ++i )
+	{
+		fprintf( mCsv, ",%s_ms", PHASE_NAMES[ i ] );
+	}
+	fprintf( mCsv, ",total_ms\n" );
+
+	return true;
+}
+
+void FrameTimer::closeCsv()
+{
+	if( mCsv != NULL )
+	{
+		fclose( mCsv );
+		mCsv = NULL;
+	}
+}
+
+double FrameTimer::getPercentile( int phase, double percentile )
+{
+	if( mStored == 0 )
+	{
+		return 0;
+	}
+
+	//Sort a copy of the history
+	double times[ FRAME_HISTORY ];
+	for( int i = 0; i < mStored; ++i )
+	{
+		times[ i ] = getMilliseconds( mFrames[ i ], phase );
+	}
+	int rank = (int)( percentile / 100 * ( mStored - 1 ) + 0.5 );
+	std::nth_element( times, times + rank, times + mStored );
+
+	return times[ rank ];
+}
+
+void FrameTimer::renderOverlay( SDL_Renderer* renderer, int x, int y, int height )
+{
+	//Darken the area behind the graph
+	SDL_Rect background = { x, y, FRAME_HISTORY, height };
+	SDL_SetRenderDrawBlendMode( renderer, SDL_BLENDMODE_BLEND );
+	SDL_SetRenderDrawColor( renderer, 0x00, 0x00, 0x00, 0xA0 );
+	SDL_RenderFillRect( renderer, &background );
+	SDL_SetRenderDrawBlendMode( renderer, SDL_BLENDMODE_NONE );
+
+	//One pixel wide bar per frame, oldest on the left, phases stacked from the bottom
+	double pixelsPerMs = height / GRAPH_MS;
+	SDL_Rect bars[ TOTAL_PHASES ][ FRAME_HISTORY ];
+	SDL_Rect untimed[ FRAME_HISTORY ];
+	int oldest = mStored < FRAME_HISTORY ? 0 : mNext;
+	for( int i = 0; i < mStored; ++i )
+	{
+		const FrameRecord& record = mFrames[ ( oldest + i ) % FRAME_HISTORY ];
+		int bottom = y + height;
+		for( int phase = 0; phase < TOTAL_PHASES; ++phase )
+		{
+			int barHeight = (int)( getMilliseconds( record, phase ) * pixelsPerMs );
+			barHeight = std::min( barHeight, bottom - y );
+			bottom -= barHeight;
+
+			SDL_Rect& bar = bars[ phase ][ i ];
+			bar.x = x + FRAME_HISTORY - mStored + i;
+			bar.y = bottom;
+			bar.w = 1;
+			bar.h = barHeight;
+		}
+
+		//The rest of the frame on top
+		int totalHeight = std::min( height, (int)( getMilliseconds( record, TOTAL_PHASES ) * pixelsPerMs ) );
+		untimed[ i ].x = x + FRAME_HISTORY - mStored + i;
+		untimed[ i ].y = y + height - totalHeight;
+		untimed[ i ].w = 1;
+		untimed[ i ].h = std::max( 0, bottom - untimed[ i ].y );
+	}
+	for( int phase = 0; phase < TOTAL_PHASES; ++phase )
+	{
+		const SDL_Color& color = PHASE_COLORS[ phase ];
+		SDL_SetRenderDrawColor( renderer, color.r, color.g, color.b, color.a );
+		SDL_RenderFillRects( renderer, bars[ phase ], mStored );
+	}
+	SDL_SetRenderDrawColor( renderer, 0x80, 0x80, 0x80, 0xFF );
+	SDL_RenderFillRects( renderer, untimed, mStored );
+
+	//Mark the 60 fps budget in white and the 99th percentile frame in red
+	int budget = y + height - (int)( 1000.0 / 60 * pixelsPerMs );
+	int p99 = y + height - std::min( height, (int)( getPercentile( TOTAL_PHASES, 99 ) * pixelsPerMs ) );
+	SDL_SetRenderDrawColor( renderer, 0xFF, 0xFF, 0xFF, 0xFF );
+	SDL_RenderDrawLine( renderer, x, budget, x + FRAME_HISTORY - 1, budget );
+	SDL_SetRenderDrawColor( renderer, 0xFF, 0x00, 0x00, 0xFF );
+	SDL_RenderDrawLine( renderer, x, p99, x + FRAME_HISTORY - 1, p99 );
+}
+
+double FrameTimer::getMilliseconds( const FrameRecord& record, int phase )
+{
+	if( mCounterMs == 0 )
+	{
+		mCounterMs = 1000.0 / SDL_GetPerformanceFrequency();
+	}
+
+	return ( phase == TOTAL_PHASES ? record.total : record.phases[ phase ] ) * mCounterMs;
+}
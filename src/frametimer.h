@@ -0,0 +1,106 @@
+#ifndef FRAMETIMER_H
+#define FRAMETIMER_H
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+
+//Parts of a frame that get timed
+enum FramePhase
+{
+	PHASE_EVENTS,
+	PHASE_UPDATE,
+	PHASE_LEVEL,
+	PHASE_PLAYER,
+	PHASE_PRESENT,
+	TOTAL_PHASES
+};
+
+//Frames of timing history kept
+const int FRAME_HISTORY = 240;
+
+//Records how long each phase of recent frames took
+class FrameTimer
+{
+	public:
+		//Initializes variables
+		FrameTimer();
+
+		//Closes the CSV file
+		~FrameTimer();
+
+		//Starts timing a new frame
+		void beginFrame();
+
+		//Adds performance counter time to a phase of the current frame
+		void add( int phase, Uint64 elapsed );
+
+		//Stores the current frame in the history and the CSV file
+		void endFrame();
+
+		//Starts writing every frame to a CSV file
+		bool openCsv( const char* path );
+
+		//Stops writing frames
+		void closeCsv();
+
+		//Milliseconds taken by a phase at a percentile of the history, TOTAL_PHASES for whole frames
+		double getPercentile( int phase, double percentile );
+
+		//Draws the recent frame times as a stacked graph
+		void renderOverlay( SDL_Renderer* renderer, int x, int y, int height );
+
+		//Shows or hides the overlay
+		void toggleOverlay() { mOverlayShown = !mOverlayShown; }
+		bool isOverlayShown() { return mOverlayShown; }
+
+		//Frames timed so far
+		Uint64 getFrameCount() { return mFrameCount; }
+
+	private:
+		//Times of one frame, in performance counter units
+		struct FrameRecord
+		{
+			Uint64 phases[ TOTAL_PHASES ];
+			Uint64 total;
+		};
+
+		//Milliseconds a record spent on a phase, TOTAL_PHASES for the whole frame
+		double getMilliseconds( const FrameRecord& record, int phase );
+
+		//Recent frames, oldest at mNext once full
+		FrameRecord mFrames[ FRAME_HISTORY ];
+		int mNext;
+		int mStored;
+
+		//The frame being timed
+		FrameRecord mCurrent;
+		Uint64 mFrameStart;
+		Uint64 mFrameCount;
+
+		//Milliseconds per performance counter unit
+		double mCounterMs;
+
+		//Per frame CSV output
+		FILE* mCsv;
+
+		//Whether the overlay is drawn
+		bool mOverlayShown;
+};
+
+//Times a phase from construction to the end of the scope
+class ScopedTimer
+{
+	public:
+		//Starts timing
+		ScopedTimer( FrameTimer& timer, int phase ) : mTimer( timer ), mPhase( phase ), mStart( SDL_GetPerformanceCounter() ) {}
+
+		//Adds the time taken to the phase
+		~ScopedTimer() { mTimer.add( mPhase, SDL_GetPerformanceCounter() - mStart ); }
+
+	private:
+		FrameTimer& mTimer;
+		int mPhase;
+		Uint64 mStart;
+};
+
+#endif
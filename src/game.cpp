@@ -0,0 +1,1225 @@
+#include "game.h"
+#include <SDL2/SDL_image.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+//A key press or release fed to the player in headless runs
+struct ScriptedKey
+{
+	//Milliseconds into the script
+	Uint32 time;
+
+	SDL_Keycode key;
+	bool down;
+};
+
+//Headless input, walks into the walls around the start and repeats
+constexpr ScriptedKey INPUT_SCRIPT[] =
+{
+	{ 0, SDLK_RIGHT, true },
+	{ 3000, SDLK_RIGHT, false },
+	{ 3000, SDLK_DOWN, true },
+	{ 5000, SDLK_DOWN, false },
+	{ 5000, SDLK_LEFT, true },
+	{ 5000, SDLK_UP, true },
+	{ 6000, SDLK_UP, false },
+	{ 8000, SDLK_LEFT, false },
+	{ 8000, SDLK_UP, true },
+	{ 10000, SDLK_UP, false }
+};
+const int INPUT_SCRIPT_KEYS = sizeof( INPUT_SCRIPT ) / sizeof( INPUT_SCRIPT[ 0 ] );
+const Uint32 INPUT_SCRIPT_LENGTH = 10500;
+
+//Run time settings
+Options gOptions;
+
+//The window we'll be rendering to
+SDL_Window* gWindow = NULL;
+
+//The window renderer
+SDL_Renderer* gRenderer = NULL;
+
+//Shared textures by path, outlives the textures holding them
+TextureCache gTextureCache;
+
+//Scene textures
+LTexture gGambitTexture;
+Atlas gGambitAtlas;
+LTexture gTileTexture;
+Atlas gTileAtlas;
+
+//Batched tile geometry
+TileBatch gTileBatch;
+
+//Prerendered level chunks
+ChunkCache gChunkCache;
+
+//Per phase frame times
+FrameTimer gFrameTimer;
+
+//Background image decoding and map parsing
+AssetLoader gAssetLoader;
+
+//The player and everything else walking about
+EntityWorld gEntities;
+
+//Worker threads for the simulation
+JobSystem gJobs;
+
+//Routes over the level
+PathFinder gPaths;
+
+//Tile the crowd heads for, -1 when it wanders
+static int sDockTile = -1;
+
+//What a movement job needs besides its range
+struct MoveJob
+{
+	Level* level;
+	int tickRate;
+};
+
+//One part of the contact search
+struct ContactPart
+{
+	std::vector<EntityPair> contacts;
+	int candidates;
+};
+
+//Contact search parts, kept to reuse their memory
+static std::vector<ContactPart> sContactParts;
+
+//Job bodies over entity slots or contact parts
+static void moveJob( int first, int last, void* data )
+{
+	MoveJob* job = (MoveJob*)data;
+	gEntities.moveRange( *job->level, job->tickRate, first, last );
+}
+
+static void animateJob( int first, int last, void* data )
+{
+	gEntities.animateRange( *(Uint32*)data, first, last );
+}
+
+static void steerJob( int first, int last, void* data )
+{
+	gEntities.steerRange( *(const FlowField*)data, player::GAMBIT_VEL, first, last );
+}
+
+static void contactJob( int first, int last, void* data )
+{
+	int parts = (int)sContactParts.size();
+	for( int part = first; part < last; ++part )
+	{
+		//Pairs sharing a grid cell, keeping the ones really touching
+		std::vector<EntityPair>& contacts = sContactParts[ part ].contacts;
+		sContactParts[ part ].candidates = gEntities.findPairs( contacts, part, parts );
+		size_t touching = 0;
+		for( size_t i = 0; i < contacts.size(); ++i )
+		{
+			if( checkCollision( gEntities.getBox( contacts[ i ].a ), gEntities.getBox( contacts[ i ].b ) ) )
+			{
+				contacts[ touching++ ] = contacts[ i ];
+			}
+		}
+		contacts.resize( touching );
+	}
+}
+
+static void gridJob( int first, int last, void* data )
+{
+	gEntities.updateGrid( *(int*)data );
+}
+
+//Sizes the contact search parts, split between the job threads once there are enough entities to go around
+static int beginContacts()
+{
+	int parts = 1;
+	if( gEntities.getCount() >= ENTITY_JOB_GRAIN )
+	{
+		parts = gJobs.getThreadCount() * CONTACT_PARTS_PER_THREAD;
+	}
+	sContactParts.resize( parts );
+	return parts;
+}
+
+//Joins the contact search parts in bucket order, which lists the contacts the same however many threads there are
+static int joinContacts( std::vector<EntityPair>& contacts, int& candidates )
+{
+	contacts.clear();
+	candidates = 0;
+	for( size_t part = 0; part < sContactParts.size(); ++part )
+	{
+		contacts.insert( contacts.end(), sContactParts[ part ].contacts.begin(), sContactParts[ part ].contacts.end() );
+		candidates += sContactParts[ part ].candidates;
+	}
+
+	return (int)contacts.size();
+}
+
+//Answers path queries, gets the field the crowd heading for the dock follows, NULL if there's none
+static const FlowField* updatePaths()
+{
+	gPaths.update( gJobs, PATH_QUERIES_PER_TICK );
+	return sDockTile >= 0 ? gPaths.getFlowField( sDockTile ) : NULL;
+}
+
+LTexture::LTexture()
+{
+	//Initialize
+	mTexture = NULL;
+	mWidth = 0;
+	mHeight = 0;
+}
+
+LTexture::~LTexture()
+{
+	//Deallocate
+	free();
+}
+
+bool LTexture::loadFromFile( std::string path )
+{
+	TRACE_SCOPE( "LTexture::loadFromFile" );
+
+	//Load image at specified path
+	SDL_Surface* loadedSurface = IMG_Load( path.c_str() );
+	if( loadedSurface == NULL )
+	{
+		printf( "Unable to load image %s! SDL_image Error: %s\n", path.c_str(), IMG_GetError() );
+		free();
+		return false;
+	}
+
+	bool success = loadFromSurface( loadedSurface );
+	if( !success )
+	{
+		printf( "Unable to create texture from %s!\n", path.c_str() );
+	}
+
+	//Get rid of old loaded surface
+	SDL_FreeSurface( loadedSurface );
+
+	return success;
+}
+
+bool LTexture::loadFromSurface( SDL_Surface* surface )
+{
+	//Get rid of preexisting texture
+	free();
+
+	//Color key image
+	SDL_SetColorKey( surface, SDL_TRUE, SDL_MapRGB( surface->format, 0, 0xFF, 0xFF ) );
+
+	//Create texture from surface pixels
+	mTexture = SDL_CreateTextureFromSurface( gRenderer, surface );
+	if( mTexture == NULL )
+	{
+		printf( "Unable to create texture! SDL Error: %s\n", SDL_GetError() );
+	}
+	else
+	{
+		//Get image dimensions
+		mWidth = surface->w;
+		mHeight = surface->h;
+	}
+
+	//Return success
+	return mTexture != NULL;
+}
+
+bool LTexture::setTexture( TextureRef texture )
+{
+	//Get rid of preexisting texture
+	free();
+
+	mRef = texture;
+	mTexture = mRef.get();
+	mWidth = mRef.getWidth();
+	mHeight = mRef.getHeight();
+
+	return mTexture != NULL;
+}
+
+#ifdef _SDL_TTF_H
+bool LTexture::loadFromRenderedText( std::string textureText, SDL_Color textColor )
+{
+	//Get rid of preexisting texture
+	free();
+
+	//Render text surface
+	SDL_Surface* textSurface = TTF_RenderText_Solid( gFont, textureText.c_str(), textColor );
+	if( textSurface != NULL )
+	{
+		//Create texture from surface pixels
+        mTexture = SDL_CreateTextureFromSurface( gRenderer, textSurface );
+		if( mTexture == NULL )
+		{
+			printf( "Unable to create texture from rendered text! SDL Error: %s\n", SDL_GetError() );
+		}
+		else
+		{
+			//Get image dimensions
+			mWidth = textSurface->w;
+			mHeight = textSurface->h;
+		}
+
+		//Get rid of old surface
+		SDL_FreeSurface( textSurface );
+	}
+	else
+	{
+		printf( "Unable to render text surface! SDL_ttf Error: %s\n", TTF_GetError() );
+	}
+
+	
+	//Return success
+	return mTexture != NULL;
+}
+#endif
+
+void LTexture::free()
+{
+	//Free texture if it exists, shared ones are left to the cache
+	if( mTexture != NULL )
+	{
+		if( mRef.isValid() )
+		{
+			mRef.release();
+		}
+		else
+		{
+			SDL_DestroyTexture( mTexture );
+		}
+		mTexture = NULL;
+		mWidth = 0;
+		mHeight = 0;
+	}
+}
+
+void LTexture::setColor( Uint8 red, Uint8 green, Uint8 blue )
+{
+	//Modulate texture rgb
+	SDL_SetTextureColorMod( mTexture, red, green, blue );
+}
+
+void LTexture::setBlendMode( SDL_BlendMode blending )
+{
+	//Set blending function
+	SDL_SetTextureBlendMode( mTexture, blending );
+}
+		
+void LTexture::setAlpha( Uint8 alpha )
+{
+	//Modulate texture alpha
+	SDL_SetTextureAlphaMod( mTexture, alpha );
+}
+
+void LTexture::render( int x, int y, const SDL_Rect* clip, double angle, SDL_Point* center, SDL_RendererFlip flip )
+{
+	//Set rendering space and render to screen
+	SDL_Rect renderQuad = { x, y, mWidth, mHeight };
+
+	//Set clip rendering dimensions
+	if( clip != NULL )
+	{
+		renderQuad.w = clip->w;
+		renderQuad.h = clip->h;
+	}
+
+	//Render to screen
+	SDL_RenderCopyEx( gRenderer, getTexture(), clip, &renderQuad, angle, center, flip );
+}
+
+int LTexture::getWidth()
+{
+	return mWidth;
+}
+
+int LTexture::getHeight()
+{
+	return mHeight;
+}
+
+SDL_Texture* LTexture::getTexture()
+{
+	//Let the cache know a shared texture is still in use
+	if( mRef.isValid() )
+	{
+		return mRef.get();
+	}
+
+	return mTexture;
+}
+
+player::player()
+{
+    //Start in the top left corner, standing
+    SDL_Rect box = { 0, 0, GAMBIT_WIDTH, GAMBIT_HEIGHT };
+    mEntity = gEntities.create( box, &GAMBIT_LOOK, FACING_UP );
+
+    //Initialize the velocity
+    mVelX = 0;
+    mVelY = 0;
+}
+
+player::~player()
+{
+    gEntities.destroy( mEntity );
+}
+
+SDL_Rect player::getBox()
+{
+    return gEntities.getBox( mEntity );
+}
+
+void player::handleEvent( SDL_Event& e )
+{
+
+	bool turbo_mode=false;
+    //If a key was pressed
+	if( e.type == SDL_KEYDOWN && e.key.repeat == 0 )
+    {
+
+     if(turbo_mode==false)
+     {
+        	  switch( e.key.keysym.sym )
+        	  {        
+            	case SDLK_UP:    mVelY -= GAMBIT_VEL; break;
+            	case SDLK_DOWN:  mVelY += GAMBIT_VEL; break;
+            	case SDLK_LEFT:  mVelX -= GAMBIT_VEL; break;
+            	case SDLK_RIGHT: mVelX += GAMBIT_VEL; break;
+            
+         		case SDLK_w: mVelY -= GAMBIT_VEL;  break;
+        	     case SDLK_s: mVelY += GAMBIT_VEL;  break;
+          	case SDLK_a: mVelX -= GAMBIT_VEL;  break;
+        	     case SDLK_d: mVelX += GAMBIT_VEL;  break;
+            }
+       }
+      else
+      {
+      	  switch( e.key.keysym.sym )
+            {
+               case SDLK_UP:    mVelY -= GAMBIT_RUN_VEL; break;
+            	case SDLK_DOWN:  mVelY += GAMBIT_RUN_VEL; break;
+            	case SDLK_LEFT:  mVelX -= GAMBIT_RUN_VEL; break;
+            	case SDLK_RIGHT: mVelX += GAMBIT_RUN_VEL; break;
+            
+         		case SDLK_w: mVelY -= GAMBIT_RUN_VEL;  break;
+        	     case SDLK_s: mVelY += GAMBIT_RUN_VEL;  break;
+          	case SDLK_a: mVelX -= GAMBIT_RUN_VEL;  break;
+        	     case SDLK_d: mVelX += GAMBIT_RUN_VEL;  break;
+            }
+
+        }
+    }
+    //If a key was released
+    else if( e.type == SDL_KEYUP && e.key.repeat == 0 )
+    {
+        //Adjust the velocity
+        if(turbo_mode==false)
+        {
+        
+        	  switch( e.key.keysym.sym )
+        	  {
+            	case SDLK_UP:    mVelY += GAMBIT_VEL; break;
+            	case SDLK_DOWN:  mVelY -= GAMBIT_VEL; break;
+            	case SDLK_LEFT:  mVelX += GAMBIT_VEL; break;
+            	case SDLK_RIGHT: mVelX -= GAMBIT_VEL; break;
+            
+            	case SDLK_w: mVelY += GAMBIT_VEL;  break;
+            	case SDLK_s: mVelY -= GAMBIT_VEL;  break;
+            	case SDLK_a: mVelX += GAMBIT_VEL;  break;
+            	case SDLK_d: mVelX -= GAMBIT_VEL;  break;
+            }
+         }
+         else
+         {
+        	switch( e.key.keysym.sym )
+        	  {
+            	case SDLK_UP:    mVelY += GAMBIT_RUN_VEL; break;
+            	case SDLK_DOWN:  mVelY -= GAMBIT_RUN_VEL; break;
+            	case SDLK_LEFT:  mVelX += GAMBIT_RUN_VEL; break;
+            	case SDLK_RIGHT: mVelX -= GAMBIT_RUN_VEL; break;
+            
+            	case SDLK_w: mVelY += GAMBIT_VEL;  break;
+            	case SDLK_s: mVelY -= GAMBIT_VEL;  break;
+            	case SDLK_a: mVelX += GAMBIT_VEL;  break;
+            	case SDLK_d: mVelX -= GAMBIT_VEL;  break;
+            	
+            }
+            
+        }
+    }
+
+    //Hand the velocity to the entity
+    gEntities.setVelocity( mEntity, mVelX, mVelY );
+}
+
+void player::setCamera( SDL_Rect& camera, Level& level )
+{
+	//Center the camera over the dot
+	SDL_Rect box = getBox();
+	camera.x = ( box.x + GAMBIT_WIDTH / 2 ) - SCREEN_WIDTH / 2;
+	camera.y = ( box.y + GAMBIT_HEIGHT / 2 ) - SCREEN_HEIGHT / 2;
+
+	//Keep the camera in bounds
+	if( camera.x < 0 )
+	{ 
+		camera.x = 0;
+	}
+	if( camera.y < 0 )
+	{
+		camera.y = 0;
+	}
+	if( camera.x > level.getWidth() - camera.w )
+	{
+		camera.x = level.getWidth() - camera.w;
+	}
+	if( camera.y > level.getHeight() - camera.h )
+	{
+		camera.y = level.getHeight() - camera.h;
+	}
+}
+
+bool parseOptions( int argc, char* args[], Options& options )
+{
+	//Defaults
+	options.tickRate = DEFAULT_TICK_RATE;
+	options.frameCap = 0;
+	options.vsync = true;
+	options.headless = false;
+	options.headlessTicks = DEFAULT_HEADLESS_TICKS;
+	options.frameCsv = NULL;
+	options.tracePath = NULL;
+	options.textureBudget = DEFAULT_TEXTURE_BUDGET;
+	options.mapPath = NULL;
+	options.compressTiles = false;
+	options.crowd = 0;
+	options.jobs = -1;
+	options.seekDock = false;
+
+	for( int i = 1; i < argc; ++i )
+	{
+		if( strcmp( args[ i ], "--tick-rate" ) == 0 && i + 1 < argc )
+		{
+			options.tickRate = atoi( args[ ++i ] );
+		}
+		else if( strcmp( args[ i ], "--fps-cap" ) == 0 && i + 1 < argc )
+		{
+			options.frameCap = atoi( args[ ++i ] );
+		}
+		else if( strcmp( args[ i ], "--no-vsync" ) == 0 )
+		{
+			options.vsync = false;
+		}
+		else if( strcmp( args[ i ], "--headless" ) == 0 )
+		{
+			options.headless = true;
+		}
+		else if( strcmp( args[ i ], "--ticks" ) == 0 && i + 1 < argc )
+		{
+			options.headlessTicks = atoi( args[ ++i ] );
+		}
+		else if( strcmp( args[ i ], "--frame-csv" ) == 0 && i + 1 < argc )
+		{
+			options.frameCsv = args[ ++i ];
+		}
+		else if( strcmp( args[ i ], "--trace" ) == 0 && i + 1 < argc )
+		{
+			options.tracePath = args[ ++i ];
+		}
+		else if( strcmp( args[ i ], "--texture-budget" ) == 0 && i + 1 < argc )
+		{
+			options.textureBudget = atoi( args[ ++i ] );
+		}
+		else if( strcmp( args[ i ], "--map" ) == 0 && i + 1 < argc )
+		{
+			options.mapPath = args[ ++i ];
+		}
+		else if( strcmp( args[ i ], "--crowd" ) == 0 && i + 1 < argc )
+		{
+			options.crowd = atoi( args[ ++i ] );
+		}
+		else if( strcmp( args[ i ], "--compress-tiles" ) == 0 )
+		{
+			options.compressTiles = true;
+		}
+		else if( strcmp( args[ i ], "--jobs" ) == 0 && i + 1 < argc )
+		{
+			options.jobs = atoi( args[ ++i ] );
+		}
+		else if( strcmp( args[ i ], "--seek-dock" ) == 0 )
+		{
+			options.seekDock = true;
+		}
+		else
+		{
+			printf( "Usage: %s [--tick-rate <hz>] [--fps-cap <fps>] [--no-vsync] [--frame-csv <path>] [--trace <path>] [--texture-budget <mb>] [--map <path>] [--compress-tiles] [--crowd <n>] [--seek-dock] [--jobs <n>] [--headless [--ticks <n>]]\n", args[ 0 ] );
+			return false;
+		}
+	}
+
+	//The simulation needs to tick
+	if( options.tickRate <= 0 || options.frameCap < 0 || options.headlessTicks < 0 || options.textureBudget < 0 || options.crowd < 0 || options.jobs < -1 )
+	{
+		printf( "Tick rate must be positive, frame cap, ticks, texture budget, crowd and jobs not negative!\n" );
+		return false;
+	}
+
+	//Ticks shorter than the performance counter can time would never come due
+	if( options.tickRate > MAX_TICK_RATE || (Uint64)options.tickRate > SDL_GetPerformanceFrequency() )
+	{
+		printf( "Tick rate can be at most %d!\n", MAX_TICK_RATE );
+		return false;
+	}
+
+	return true;
+}
+
+bool runHeadless( Level& level, int ticks )
+{
+	TRACE_SCOPE( "runHeadless" );
+
+	//player, driven by the script
+	player player;
+
+	//Level camera
+	SDL_Rect camera = { 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT };
+
+	//Place in the script
+	int nextKey = 0;
+	Uint32 lastLoop = 0;
+
+	//Start with the chunks around the camera in
+	level.waitForStreaming( camera );
+
+	//Company for the player
+	spawnCrowd( level, gOptions.crowd );
+	std::vector<EntityPair> contacts;
+	int touching = 0;
+	int candidates = 0;
+
+	//The player's way to the dock, queued like an agent's would be
+	PathId dockPath = -1;
+	if( sDockTile >= 0 )
+	{
+		SDL_Rect start = player.getBox();
+		dockPath = gPaths.request( ( start.y / TILE_HEIGHT ) * level.getColumns() + start.x / TILE_WIDTH, sDockTile );
+	}
+
+	Uint64 start = SDL_GetPerformanceCounter();
+	for( int tick = 0; tick < ticks; ++tick )
+	{
+		//Where this tick falls in the script
+		Uint64 time = (Uint64)tick * 1000 / gOptions.tickRate;
+		Uint32 loop = (Uint32)( time / INPUT_SCRIPT_LENGTH );
+		Uint32 scriptTime = (Uint32)( time % INPUT_SCRIPT_LENGTH );
+		if( loop != lastLoop )
+		{
+			nextKey = 0;
+			lastLoop = loop;
+		}
+
+		//Feed the keys that are due
+		while( nextKey < INPUT_SCRIPT_KEYS && INPUT_SCRIPT[ nextKey ].time <= scriptTime )
+		{
+			SDL_Event e;
+			memset( &e, 0, sizeof( e ) );
+			e.type = INPUT_SCRIPT[ nextKey ].down ? SDL_KEYDOWN : SDL_KEYUP;
+			e.key.keysym.sym = INPUT_SCRIPT[ nextKey ].key;
+			player.handleEvent( e );
+			nextKey++;
+		}
+
+		//Same steps as a tick of the main loop
+		gEntities.savePositions();
+		touching = updateEntities( level, contacts, candidates );
+		player.setCamera( camera, level );
+		level.updateStreaming( camera );
+	}
+	Uint64 end = SDL_GetPerformanceCounter();
+
+	//Report the throughput and where the player ended up, which should never change between builds
+	double seconds = (double)( end - start ) / SDL_GetPerformanceFrequency();
+	SDL_Rect box = player.getBox();
+	printf( "Headless: %d ticks in %.3f s, %.0f ticks per second, %.1f ns per tick\n", ticks, seconds, seconds > 0 ? ticks / seconds : 0.0, ticks > 0 ? seconds * 1e9 / ticks : 0.0 );
+	printf( "Headless: player ended at %d,%d, camera at %d,%d\n", box.x, box.y, camera.x, camera.y );
+	if( gOptions.crowd > 0 )
+	{
+		printf( "Headless: %d of %d entities, %d contacts of %d candidate pairs on the last tick\n", gEntities.getCount(), gOptions.crowd + 1, touching, candidates );
+	}
+	if( sDockTile >= 0 )
+	{
+		std::vector<int> path;
+		std::vector<EntityId> docked;
+		gEntities.updateGrid();
+		gPaths.finish( gJobs );
+		int turns = gPaths.getPath( dockPath, path ) ? (int)path.size() : -1;
+		printf( "Headless: path from the start to the dock turns at %d tiles, %d entities made it onto the dock\n", turns, gEntities.query( level.getBox( sDockTile ), docked ) );
+		gPaths.release( dockPath );
+	}
+
+	return true;
+}
+
+bool initJobs()
+{
+	//Leave a core for the main thread, which runs jobs too while it waits on them
+	int workers = gOptions.jobs >= 0 ? gOptions.jobs : SDL_max( 0, SDL_GetCPUCount() - 1 );
+	if( !gJobs.init( workers ) )
+	{
+		printf( "Running jobs on the main thread!\n" );
+		return false;
+	}
+
+	return true;
+}
+
+bool init()
+{
+	TRACE_SCOPE( "init" );
+
+	//Initialization flag
+	bool success = true;
+
+	//Initialize SDL
+	if( SDL_Init( SDL_INIT_VIDEO ) < 0 )
+	{
+		printf( "SDL could not initialize! SDL Error: %s\n", SDL_GetError() );
+		success = false;
+	}
+	else
+	{
+		//Set texture filtering to linear
+		if( !SDL_SetHint( SDL_HINT_RENDER_SCALE_QUALITY, "1" ) )
+		{
+			printf( "Warning: Linear texture filtering not enabled!" );
+		}
+
+		//Create window
+		gWindow = SDL_CreateWindow( "red_rockit", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN );
+		if( gWindow == NULL )
+		{
+			printf( "Window could not be created! SDL Error: %s\n", SDL_GetError() );
+			success = false;
+		}
+		else
+		{
+			//Create renderer for window
+			Uint32 rendererFlags = SDL_RENDERER_ACCELERATED;
+			if( gOptions.vsync )
+			{
+				rendererFlags |= SDL_RENDERER_PRESENTVSYNC;
+			}
+			gRenderer = SDL_CreateRenderer( gWindow, -1, rendererFlags );
+			if( gRenderer == NULL )
+			{
+				printf( "Renderer could not be created! SDL Error: %s\n", SDL_GetError() );
+				success = false;
+			}
+			else
+			{
+				//Initialize renderer color
+				SDL_SetRenderDrawColor( gRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
+
+				//Initialize PNG loading
+				int imgFlags = IMG_INIT_PNG;
+				if( !( IMG_Init( imgFlags ) & imgFlags ) )
+				{
+					printf( "SDL_image could not initialize! SDL_image Error: %s\n", IMG_GetError() );
+					success = false;
+				}
+			}
+		}
+	}
+
+	return success;
+}
+
+bool loadMedia( Level& level )
+{
+	TRACE_SCOPE( "loadMedia" );
+
+	//Loading success flag
+	bool success = true;
+
+	//Clip the packed world atlas if it has been built, the separate sheets otherwise
+	if( loadPackedAtlas( gTileAtlas, "tiles" ) && loadPackedAtlas( gGambitAtlas, "player" ) )
+	{
+		printf( "Using packed atlas %s\n", gTileAtlas.getImagePath().c_str() );
+	}
+	else
+	{
+		gGambitAtlas.setRects( GAMBIT_SHEET, TOTAL_GAMBIT_SPRITES );
+		gTileAtlas.setRects( TILE_SHEET, TOTAL_TILE_SPRITES );
+	}
+
+	//Start the loader threads, leaving a core for rendering
+	if( !gAssetLoader.isRunning() )
+	{
+		int threads = SDL_max( 1, SDL_min( MAX_LOADER_THREADS, SDL_GetCPUCount() - 1 ) );
+		if( !gAssetLoader.init( threads ) )
+		{
+			printf( "Loading on the main thread!\n" );
+		}
+	}
+	gAssetLoader.setProgressCallback( renderLoading, NULL );
+
+	//Textures are shared through the cache, cyan is transparent
+	gTextureCache.setRenderer( gRenderer );
+	gTextureCache.setColorKey( 0, 0xFF, 0xFF );
+	gTextureCache.setBudget( (size_t)gOptions.textureBudget * 1024 * 1024 );
+
+	//Parse the tile map while the textures decode
+	AssetHandle map = gAssetLoader.loadLevel( &level, setTiles );
+
+	//Load textures, waits for the map too
+	if( !loadTextures() )
+	{
+		success = false;
+	}
+
+	//Check the tile map
+	if( gAssetLoader.getState( map ) != ASSET_READY )
+	{
+		printf( "Failed to load tile set!\n" );
+		success = false;
+	}
+	else
+	{
+		printf( "Level: %d tiles, %lu bytes%s\n", level.getTotalTiles(), (unsigned long)level.getMemoryUsage(), level.isCompressed() ? " compressed" : "" );
+
+		//Bake the static map in chunks when the renderer allows it
+		gChunkCache.init( gRenderer, level );
+
+		//Rebake chunks as streamed tiles arrive under them
+		level.setLoadedCallback( invalidateChunks, NULL );
+	}
+
+	printf( "Textures: %d, %lu bytes of %lu\n", gTextureCache.getCount(), (unsigned long)gTextureCache.getMemoryUsage(), (unsigned long)gTextureCache.getBudget() );
+
+	return success;
+}
+
+bool loadPackedAtlas( Atlas& atlas, std::string group )
+{
+	//Try each page the packer wrote until one has the group
+	for( int page = 0; ; ++page )
+	{
+		char path[ 256 ];
+		snprintf( path, sizeof( path ), "%s%d.atlas", PACKED_ATLAS_PREFIX, page );
+
+		FILE* file = fopen( path, "r" );
+		if( file == NULL )
+		{
+			return false;
+		}
+		fclose( file );
+
+		if( atlas.loadFromFile( path, group ) )
+		{
+			return true;
+		}
+	}
+}
+
+//Uploads a decoded image through the cache and shares it with an LTexture
+static bool uploadTexture( const std::string& path, SDL_Surface* surface, void* texture )
+{
+	return ( (LTexture*)texture )->setTexture( gTextureCache.insert( path, surface ) );
+}
+
+//Shares a cached texture, or queues the image to decode
+static void queueTexture( LTexture& texture, std::string path )
+{
+	texture.free();
+
+	TextureRef cached = gTextureCache.find( path );
+	if( cached.isValid() )
+	{
+		texture.setTexture( cached );
+	}
+	else
+	{
+		gAssetLoader.loadImage( path, uploadTexture, &texture );
+	}
+}
+
+bool loadTextures()
+{
+	//Loading success flag
+	bool success = true;
+
+	//Sheets named by the atlases, a packed atlas is decoded once and shared
+	std::string gambitSheet = gGambitAtlas.getImagePath().empty() ? "textures/player.png" : gGambitAtlas.getImagePath();
+	std::string tileSheet = gTileAtlas.getImagePath().empty() ? "textures/tiles.png" : gTileAtlas.getImagePath();
+
+	//Decode the images in the background
+	queueTexture( gGambitTexture, gambitSheet );
+	if( tileSheet != gambitSheet )
+	{
+		queueTexture( gTileTexture, tileSheet );
+	}
+	gAssetLoader.finish();
+	if( tileSheet == gambitSheet )
+	{
+		gTileTexture.setTexture( gTextureCache.find( tileSheet ) );
+	}
+
+	//Check player texture
+	if( gGambitTexture.getTexture() == NULL )
+	{
+		printf( "Failed to load player texture!\n" );
+		success = false;
+	}
+
+	//Check tile texture
+	if( gTileTexture.getTexture() == NULL )
+	{
+		printf( "Failed to load tile set texture!\n" );
+		success = false;
+	}
+
+	return success;
+}
+
+void renderLoading( int done, int total, void* data )
+{
+	//Bar across the middle of the screen
+	SDL_Rect outline = { SCREEN_WIDTH / 4, SCREEN_HEIGHT / 2 - 10, SCREEN_WIDTH / 2, 20 };
+	SDL_Rect bar = { outline.x + 2, outline.y + 2, ( outline.w - 4 ) * done / SDL_max( total, 1 ), outline.h - 4 };
+
+	SDL_SetRenderDrawColor( gRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
+	SDL_RenderClear( gRenderer );
+	SDL_SetRenderDrawColor( gRenderer, 0x00, 0x00, 0x00, 0xFF );
+	SDL_RenderDrawRect( gRenderer, &outline );
+	SDL_RenderFillRect( gRenderer, &bar );
+	SDL_RenderPresent( gRenderer );
+}
+
+void invalidateChunks( int firstCol, int firstRow, int lastCol, int lastRow, void* data )
+{
+	gChunkCache.invalidateArea( firstCol, firstRow, lastCol, lastRow );
+}
+
+void close( Level& level )
+{
+	//Deallocate map tiles
+	level.free();
+
+	//Stop the loader threads
+	gAssetLoader.free();
+
+	//Remove the crowd and its routes, and stop the job workers
+	gEntities.clear();
+	gPaths.free();
+	gJobs.free();
+
+	//Free loaded images
+	gChunkCache.free();
+	gGambitTexture.free();
+	gTileTexture.free();
+	gTextureCache.clear();
+
+	//Finish the frame time dump
+	gFrameTimer.closeCsv();
+
+	//Destroy window	
+	SDL_DestroyRenderer( gRenderer );
+	SDL_DestroyWindow( gWindow );
+	gWindow = NULL;
+	gRenderer = NULL;
+
+	//Quit SDL subsystems
+	IMG_Quit();
+	SDL_Quit();
+}
+
+bool checkCollision( SDL_Rect a, SDL_Rect b )
+{
+    //The sides of the rectangles
+    int leftA, leftB;
+    int rightA, rightB;
+    int topA, topB;
+    int bottomA, bottomB;
+
+    //Calculate the sides of rect A
+    leftA = a.x;
+    rightA = a.x + a.w;
+    topA = a.y;
+    bottomA = a.y + a.h;
+
+    //Calculate the sides of rect B
+    leftB = b.x;
+    rightB = b.x + b.w;
+    topB = b.y;
+    bottomB = b.y + b.h;
+
+    //If any of the sides from A are outside of B
+    if( bottomA <= topB )
+    {
+        return false;
+    }
+
+    if( topA >= bottomB )
+    {
+        return false;
+    }
+
+    if( rightA <= leftB )
+    {
+        return false;
+    }
+
+    if( leftA >= rightB )
+    {
+        return false;
+    }
+
+    //If none of the sides from A are outside B
+    return true;
+}
+
+bool setTiles( Level& level )
+{
+	TRACE_SCOPE( "setTiles" );
+
+	//Load the map asked for
+	bool tilesLoaded;
+	if( gOptions.mapPath != NULL )
+	{
+		tilesLoaded = level.loadFromFile( gOptions.mapPath );
+	}
+	else
+	{
+		//Load the converted map, or parse the text map if it hasn't been built
+		tilesLoaded = level.loadFromFile( "maps/level1.rkm" );
+		if( !tilesLoaded )
+		{
+			printf( "Falling back to text map!\n" );
+			tilesLoaded = level.loadFromFile( "maps/level1.map" );
+		}
+	}
+
+	//Trade a little lookup time for memory on big maps
+	if( tilesLoaded && gOptions.compressTiles )
+	{
+		level.compress();
+	}
+
+    //If the map was loaded fine
+    return tilesLoaded;
+}
+
+void spawnCrowd( Level& level, int count )
+{
+	//Drop the routes over the last level, only a crowd heading for the dock routes over this one
+	gPaths.free();
+	sDockTile = -1;
+	if( gOptions.seekDock )
+	{
+		//The path finder copies the walking costs, so big streamed worlds only pay for them when they're used
+		gPaths.init( &level );
+		sDockTile = findTile( level, TILE_DOCK );
+		if( sDockTile < 0 )
+		{
+			printf( "Warning: No dock for the crowd to head for!\n" );
+		}
+		else
+		{
+			//Build its field up front so the crowd sets off together, rebuilds after that happen in the background
+			gPaths.getFlowField( sDockTile );
+			gPaths.finish( gJobs );
+		}
+	}
+
+	//Same crowd every run
+	Uint32 seed = 1;
+	int spawned = 0;
+	for( int tries = 0; spawned < count && tries < count * 10; ++tries )
+	{
+		seed = seed * 1664525u + 1013904223u;
+		int col = (int)( ( seed >> 8 ) % (Uint32)level.getColumns() );
+		seed = seed * 1664525u + 1013904223u;
+		int row = (int)( ( seed >> 8 ) % (Uint32)level.getRows() );
+
+		//Only stand them on open ground
+		SDL_Rect box = { col * TILE_WIDTH, row * TILE_HEIGHT, player::GAMBIT_WIDTH, player::GAMBIT_HEIGHT };
+		if( box.x + box.w > level.getWidth() || box.y + box.h > level.getHeight() || touchesWall( box, level ) )
+		{
+			continue;
+		}
+
+		//Walk one of eight ways, turning back at walls, until steered
+		int direction = (int)( ( seed >> 4 ) % 8 );
+		static const int DIRECTIONS[ 8 ][ 2 ] = { { 0, -1 }, { 1, -1 }, { 1, 0 }, { 1, 1 }, { 0, 1 }, { -1, 1 }, { -1, 0 }, { -1, -1 } };
+		EntityId entity = gEntities.create( box, &GAMBIT_LOOK, FACING_DOWN, sDockTile >= 0 ? ENTITY_SEEK : ENTITY_BOUNCE );
+		if( entity == ENTITY_NONE )
+		{
+			break;
+		}
+		gEntities.setVelocity( entity, DIRECTIONS[ direction ][ 0 ] * player::GAMBIT_VEL, DIRECTIONS[ direction ][ 1 ] * player::GAMBIT_VEL );
+		spawned++;
+	}
+
+	if( spawned < count )
+	{
+		printf( "Warning: Only found room for %d of %d in the crowd!\n", spawned, count );
+	}
+}
+
+//The type findTile looks for, and the tile it turned up at
+struct TileSearch
+{
+	int type;
+	int col;
+};
+
+//Stops the walk at the first run of the type looked for
+static bool findRun( int row, int firstCol, int lastCol, int type, void* data )
+{
+	TileSearch* search = (TileSearch*)data;
+	if( type != search->type )
+	{
+		return true;
+	}
+
+	search->col = firstCol;
+	return false;
+}
+
+int findTile( Level& level, int type )
+{
+	TileSearch search = { type, -1 };
+	for( int row = 0; row < level.getRows(); ++row )
+	{
+		if( !level.visitRuns( row, 0, level.getColumns() - 1, findRun, &search ) )
+		{
+			return row * level.getColumns() + search.col;
+		}
+	}
+
+	return -1;
+}
+
+bool touchesWall( SDL_Rect box, Level& level )
+{
+    //Get the tiles under the box
+    int firstCol, firstRow, lastCol, lastRow;
+    if( !level.getTileSpan( box, firstCol, firstRow, lastCol, lastRow ) )
+    {
+        return false;
+    }
+
+    //Tiles the box covers overlap it, edges being exclusive, so any solid one is touched
+    return level.anySolid( firstCol, firstRow, lastCol, lastRow );
+}
+
+void animateEntities( Uint32 elapsed )
+{
+    TRACE_SCOPE( "animateEntities" );
+
+    gJobs.wait( gJobs.parallelFor( animateJob, &elapsed, gEntities.getCount(), ENTITY_JOB_GRAIN ) );
+    gJobs.reset();
+}
+
+int updateEntities( Level& level, std::vector<EntityPair>& contacts, int& candidates )
+{
+    TRACE_SCOPE( "updateEntities" );
+
+    //Steering sets the velocities moving reads, so the crowd heading for the dock is steered first
+    int count = gEntities.getCount();
+    JobHandle steered = NULL;
+    const FlowField* field = gOptions.seekDock ? updatePaths() : NULL;
+    if( field != NULL )
+    {
+        steered = gJobs.parallelFor( steerJob, (void*)field, count, ENTITY_JOB_GRAIN );
+    }
+
+    //Each entity only touches its own slot, so the crowd splits into ranges
+    MoveJob move = { &level, gOptions.tickRate };
+    JobHandle moved = gJobs.parallelFor( moveJob, &move, count, ENTITY_JOB_GRAIN, &steered, 1 );
+
+    //Once everyone has moved, file them in the grid then search its parts
+    JobHandle last = moved;
+    int parts = 0;
+    if( count > 1 )
+    {
+        parts = beginContacts();
+        JobHandle filed = gJobs.add( gridJob, &parts, 0, 0, &moved, 1 );
+        last = gJobs.parallelFor( contactJob, NULL, parts, 1, &filed, 1 );
+    }
+    gJobs.wait( last );
+    gJobs.reset();
+
+    if( parts == 0 )
+    {
+        contacts.clear();
+        candidates = 0;
+        return 0;
+    }
+    return joinContacts( contacts, candidates );
+}
+
+int renderLevel( Level& level, SDL_Rect& camera )
+{
+    //Show the prebaked chunks if there are any
+    if( gChunkCache.isEnabled() )
+    {
+        return gChunkCache.render( level, camera, gTileTexture.getTexture(), gTileTexture.getWidth(), gTileTexture.getHeight(), gTileAtlas );
+    }
+
+    //Get the tiles under the camera
+    int firstCol, firstRow, lastCol, lastRow;
+    if( !level.getTileSpan( camera, firstCol, firstRow, lastCol, lastRow ) )
+    {
+        return 0;
+    }
+
+    //Queue only the on screen tiles
+    gTileBatch.clear();
+    for( int row = firstRow; row <= lastRow; ++row )
+    {
+        for( int col = firstCol; col <= lastCol; )
+        {
+            //Tiles of a run share the clip
+            int end;
+            const SDL_Rect& clip = gTileAtlas.getClip( level.getRun( col, row, end ) );
+            for( end = SDL_min( end, lastCol + 1 ); col < end; ++col )
+            {
+                SDL_Rect dest = { col * TILE_WIDTH - camera.x, row * TILE_HEIGHT - camera.y, TILE_WIDTH, TILE_HEIGHT };
+                gTileBatch.add( clip, dest );
+            }
+        }
+    }
+
+    //Draw them all from the tile sheet
+    return gTileBatch.draw( gRenderer, gTileTexture.getTexture(), gTileTexture.getWidth(), gTileTexture.getHeight() );
+}
+
+int renderFrame( Level& level, SDL_Rect& camera, float alpha )
+{
+    //Clear screen
+    SDL_SetRenderDrawColor( gRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
+    SDL_RenderClear( gRenderer );
+
+    //Render level
+    int drawCalls;
+    {
+        ScopedTimer timer( gFrameTimer, PHASE_LEVEL );
+        TRACE_SCOPE( "renderLevel" );
+        drawCalls = renderLevel( level, camera );
+    }
+
+    //Render the player and crowd
+    {
+        ScopedTimer timer( gFrameTimer, PHASE_PLAYER );
+        TRACE_SCOPE( "renderPlayer" );
+        drawCalls += gEntities.render( gRenderer, camera, alpha, gGambitTexture.getTexture(), gGambitTexture.getWidth(), gGambitTexture.getHeight(), gGambitAtlas );
+    }
+
+    return drawCalls;
+}
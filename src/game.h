@@ -0,0 +1,387 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include <SDL2/SDL.h>
+#include <string>
+#include "level.h"
+#include "tilebatch.h"
+#include "chunkcache.h"
+#include "atlas.h"
+#include "animation.h"
+#include "entities.h"
+#include "frametimer.h"
+#include "trace.h"
+#include "assetloader.h"
+#include "texturecache.h"
+#include "jobsystem.h"
+#include "pathfinder.h"
+
+//screen size
+const int SCREEN_WIDTH = 1920;
+const int SCREEN_HEIGHT = 1080;
+
+//default simulation rate in ticks per second
+const int DEFAULT_TICK_RATE = 120;
+
+//highest simulation rate, a tick a millisecond keeps every tick at least one performance counter unit long
+const int MAX_TICK_RATE = 1000;
+
+//longest frame the simulation catches up on, in seconds
+const double MAX_FRAME_TIME = 0.25;
+
+//default length of a headless run in ticks
+const int DEFAULT_HEADLESS_TICKS = 1000000;
+
+//most threads decoding assets at startup
+const int MAX_LOADER_THREADS = 4;
+
+//default texture memory budget in megabytes
+const int DEFAULT_TEXTURE_BUDGET = 256;
+
+//entities per simulation job, fewer than this run on the main thread
+const int ENTITY_JOB_GRAIN = 1024;
+
+//contact search parts per job thread, so a thread stuck on a crowded part doesn't hold up the rest
+const int CONTACT_PARTS_PER_THREAD = 4;
+
+//most path queries handed to the job workers a tick, the rest wait for the next so a burst doesn't hold up the fields
+const int PATH_QUERIES_PER_TICK = 64;
+
+//packed atlas pages built by make atlas, numbered from 0
+const char* const PACKED_ATLAS_PREFIX = "textures/world";
+
+//player constants
+const int GTILE_WIDTH = 32;
+const int GTILE_HEIGHT = 48;
+const int TOTAL_GAMBIT_SPRITES = 16;
+
+//player sprites
+const int GAMBIT_UP = 0;
+const int GAMBIT_UP1 = 1;
+const int GAMBIT_UP2 = 2;
+const int GAMBIT_UP3 = 3;
+const int GAMBIT_LEFT = 4;
+const int GAMBIT_LEFT1 = 5;
+const int GAMBIT_LEFT2 = 6;
+const int GAMBIT_LEFT3 = 7;
+const int GAMBIT_RIGHT = 8;
+const int GAMBIT_RIGHT1 = 9;
+const int GAMBIT_RIGHT2 = 10;
+const int GAMBIT_RIGHT3 = 11;
+const int GAMBIT_DOWN = 12;
+const int GAMBIT_DOWN1 = 13;
+const int GAMBIT_DOWN2 = 14;
+const int GAMBIT_DOWN3 = 15;
+
+//tile sheet clips by tile sprite
+constexpr SDL_Rect TILE_SHEET[ TOTAL_TILE_SPRITES ] =
+{
+	{ 0, 0, TILE_WIDTH, TILE_HEIGHT },		//TILE_GRASS
+	{ 0, 80, TILE_WIDTH, TILE_HEIGHT },		//TILE_GRASS_PLANT1
+	{ 320, 160, TILE_WIDTH, TILE_HEIGHT },	//TILE_PATH2
+	{ 160, 80, TILE_WIDTH, TILE_HEIGHT },	//TILE_CENTER
+	{ 160, 0, TILE_WIDTH, TILE_HEIGHT },	//TILE_TOP
+	{ 240, 0, TILE_WIDTH, TILE_HEIGHT },	//TILE_TOPRIGHT
+	{ 240, 80, TILE_WIDTH, TILE_HEIGHT },	//TILE_RIGHT
+	{ 240, 160, TILE_WIDTH, TILE_HEIGHT },	//TILE_BOTTOMRIGHT
+	{ 160, 160, TILE_WIDTH, TILE_HEIGHT },	//TILE_BOTTOM
+	{ 80, 160, TILE_WIDTH, TILE_HEIGHT },	//TILE_BOTTOMLEFT
+	{ 80, 80, TILE_WIDTH, TILE_HEIGHT },	//TILE_LEFT
+	{ 80, 0, TILE_WIDTH, TILE_HEIGHT },		//TILE_TOPLEFT
+	{ 0, 240, TILE_WIDTH, TILE_HEIGHT },	//TILE_GRASS_TREE1
+	{ 0, 320, TILE_WIDTH, TILE_HEIGHT },	//TILE_GRASS_TREE2
+	{ 0, 400, TILE_WIDTH, TILE_HEIGHT },	//TILE_GRASS_TREE3
+	{ 320, 0, TILE_WIDTH, TILE_HEIGHT },	//TILE_BOAT_PART1
+	{ 400, 0, TILE_WIDTH, TILE_HEIGHT },	//TILE_BOAT_PART2
+	{ 320, 80, TILE_WIDTH, TILE_HEIGHT },	//TILE_DOCK
+	{ 0, 160, TILE_WIDTH, TILE_HEIGHT }		//TILE_PATH
+};
+
+//player sheet clips by player sprite, one row per direction
+constexpr SDL_Rect GAMBIT_SHEET[ TOTAL_GAMBIT_SPRITES ] =
+{
+	{ 0, GTILE_HEIGHT * 3, GTILE_WIDTH, GTILE_HEIGHT },					//GAMBIT_UP
+	{ GTILE_WIDTH, GTILE_HEIGHT * 3, GTILE_WIDTH, GTILE_HEIGHT },
+	{ GTILE_WIDTH * 2, GTILE_HEIGHT * 3, GTILE_WIDTH, GTILE_HEIGHT },
+	{ GTILE_WIDTH * 3, GTILE_HEIGHT * 3, GTILE_WIDTH, GTILE_HEIGHT },
+	{ 0, GTILE_HEIGHT, GTILE_WIDTH, GTILE_HEIGHT },						//GAMBIT_LEFT
+	{ GTILE_WIDTH, GTILE_HEIGHT, GTILE_WIDTH, GTILE_HEIGHT },
+	{ GTILE_WIDTH * 2, GTILE_HEIGHT, GTILE_WIDTH, GTILE_HEIGHT },
+	{ GTILE_WIDTH * 3, GTILE_HEIGHT, GTILE_WIDTH, GTILE_HEIGHT },
+	{ 0, GTILE_HEIGHT * 2, GTILE_WIDTH, GTILE_HEIGHT },					//GAMBIT_RIGHT
+	{ GTILE_WIDTH, GTILE_HEIGHT * 2, GTILE_WIDTH, GTILE_HEIGHT },
+	{ GTILE_WIDTH * 2, GTILE_HEIGHT * 2, GTILE_WIDTH, GTILE_HEIGHT },
+	{ GTILE_WIDTH * 3, GTILE_HEIGHT * 2, GTILE_WIDTH, GTILE_HEIGHT },
+	{ 0, 0, GTILE_WIDTH, GTILE_HEIGHT },								//GAMBIT_DOWN
+	{ GTILE_WIDTH, 0, GTILE_WIDTH, GTILE_HEIGHT },
+	{ GTILE_WIDTH * 2, 0, GTILE_WIDTH, GTILE_HEIGHT },
+	{ GTILE_WIDTH * 3, 0, GTILE_WIDTH, GTILE_HEIGHT }
+};
+
+//player walk cycles in milliseconds per frame, a quarter second per step
+constexpr AnimationFrame GAMBIT_WALK_FRAMES[ 4 ][ 4 ] =
+{
+	{ { GAMBIT_UP, 133 }, { GAMBIT_UP1, 50 }, { GAMBIT_UP2, 50 }, { GAMBIT_UP3, 17 } },
+	{ { GAMBIT_LEFT, 133 }, { GAMBIT_LEFT1, 50 }, { GAMBIT_LEFT2, 50 }, { GAMBIT_LEFT3, 17 } },
+	{ { GAMBIT_RIGHT, 133 }, { GAMBIT_RIGHT1, 50 }, { GAMBIT_RIGHT2, 50 }, { GAMBIT_RIGHT3, 17 } },
+	{ { GAMBIT_DOWN, 133 }, { GAMBIT_DOWN1, 50 }, { GAMBIT_DOWN2, 50 }, { GAMBIT_DOWN3, 17 } }
+};
+constexpr AnimationClip GAMBIT_WALK[ 4 ] =
+{
+	{ GAMBIT_WALK_FRAMES[ FACING_UP ], 4 },
+	{ GAMBIT_WALK_FRAMES[ FACING_LEFT ], 4 },
+	{ GAMBIT_WALK_FRAMES[ FACING_RIGHT ], 4 },
+	{ GAMBIT_WALK_FRAMES[ FACING_DOWN ], 4 }
+};
+
+//player standing sprites
+constexpr AnimationFrame GAMBIT_STAND_FRAMES[ 4 ] =
+{
+	{ GAMBIT_UP, 0 }, { GAMBIT_LEFT, 0 }, { GAMBIT_RIGHT, 0 }, { GAMBIT_DOWN, 0 }
+};
+constexpr AnimationClip GAMBIT_STAND[ 4 ] =
+{
+	{ &GAMBIT_STAND_FRAMES[ FACING_UP ], 1 },
+	{ &GAMBIT_STAND_FRAMES[ FACING_LEFT ], 1 },
+	{ &GAMBIT_STAND_FRAMES[ FACING_RIGHT ], 1 },
+	{ &GAMBIT_STAND_FRAMES[ FACING_DOWN ], 1 }
+};
+
+//player and crowd clips
+constexpr EntityLook GAMBIT_LOOK = { GAMBIT_STAND, GAMBIT_WALK };
+
+//Texture wrapper class
+class LTexture
+{
+	public:
+		//Initializes variables
+		LTexture();
+
+		//Deallocates memory
+		~LTexture();
+
+		//Loads image at specified path
+		bool loadFromFile( std::string path );
+
+		//Creates texture from a decoded image, the surface is left to the caller
+		bool loadFromSurface( SDL_Surface* surface );
+
+		//Shares a cached texture
+		bool setTexture( TextureRef texture );
+		
+		#ifdef _SDL_TTF_H
+		//Creates image from font string
+		bool loadFromRenderedText( std::string textureText, SDL_Color textColor );
+		#endif
+
+		//Deallocates texture
+		void free();
+
+		//Set color modulation
+		void setColor( Uint8 red, Uint8 green, Uint8 blue );
+
+		//Set blending
+		void setBlendMode( SDL_BlendMode blending );
+
+		//Set alpha modulation
+		void setAlpha( Uint8 alpha );
+		
+		//Renders texture at given point
+		void render( int x, int y, const SDL_Rect* clip = NULL, double angle = 0.0, SDL_Point* center = NULL, SDL_RendererFlip flip = SDL_FLIP_NONE );
+
+		//Gets image dimensions
+		int getWidth();
+		int getHeight();
+
+		//Gets the hardware texture
+		SDL_Texture* getTexture();
+
+	private:
+		//The actual hardware texture
+		SDL_Texture* mTexture;
+
+		//Hold on the texture when it's shared from the cache
+		TextureRef mRef;
+
+		//Image dimensions
+		int mWidth;
+		int mHeight;
+};
+
+//The dot that will move around on the screen, an entity driven by the keyboard
+class player
+{
+    public:
+	
+		//The dimensions of the dot
+		static const int GAMBIT_WIDTH = 25;
+		static const int GAMBIT_HEIGHT = 60;
+
+		//Maximum axis velocity of the dot in pixels per second
+		static const int GAMBIT_VEL = 180;
+		static const int GAMBIT_RUN_VEL = 900;
+
+		//Adds the dot to the entities
+		player();
+
+		//Removes the dot from the entities
+		~player();
+
+		//Takes key presses and adjusts the dot's velocity
+		void handleEvent( SDL_Event& e );
+
+		//Centers the camera over the dot
+		void setCamera( SDL_Rect& camera, Level& level );
+
+		//Gets the collision box
+		SDL_Rect getBox();
+
+    private:
+		//The dot's entity
+		EntityId mEntity;
+
+		//The velocity the keys ask for
+		int mVelX, mVelY;
+
+};
+
+//Run time settings from the command line
+struct Options
+{
+	//Simulation ticks per second
+	int tickRate;
+
+	//Most frames per second, 0 for no cap
+	int frameCap;
+
+	//Wait for the display refresh when presenting
+	bool vsync;
+
+	//Run only the simulation, without a window, for this many ticks
+	bool headless;
+	int headlessTicks;
+
+	//File to write per frame phase times to, NULL for none
+	const char* frameCsv;
+
+	//File to write a trace of frames and loading to, NULL for none
+	const char* tracePath;
+
+	//Texture memory budget in megabytes
+	int textureBudget;
+
+	//Map or chunked world to play, NULL for the first level
+	const char* mapPath;
+
+	//Keep the tiles run length encoded
+	bool compressTiles;
+
+	//Wandering entities to add around the player
+	int crowd;
+
+	//Job worker threads, -1 for one per core besides the main thread
+	int jobs;
+
+	//The crowd heads for the dock instead of wandering
+	bool seekDock;
+};
+
+//Reads settings from the command line
+bool parseOptions( int argc, char* args[], Options& options );
+
+//Runs the simulation on scripted input as fast as possible and reports ticks per second
+bool runHeadless( Level& level, int ticks );
+
+//Starts the job workers
+bool initJobs();
+
+//Starts up SDL and creates window
+bool init();
+
+//Loads media
+bool loadMedia( Level& level );
+
+//Loads the textures, also after the render device is lost
+bool loadTextures();
+
+//Loads a sprite group from the packed atlas pages, false if they haven't been built
+bool loadPackedAtlas( Atlas& atlas, std::string group );
+
+//Draws a loading bar
+void renderLoading( int done, int total, void* data );
+
+//Marks chunks for rebaking when streamed tiles arrive under them
+void invalidateChunks( int firstCol, int firstRow, int lastCol, int lastRow, void* data );
+
+//Frees media and shuts down SDL
+void close( Level& level );
+
+//Box collision detector
+bool checkCollision( SDL_Rect a, SDL_Rect b );
+
+//Checks collision box against set of tiles
+bool touchesWall( SDL_Rect box, Level& level );
+
+//Animates the player and crowd by elapsed milliseconds, spread over the job threads
+void animateEntities( Uint32 elapsed );
+
+//Runs a tick for the player and crowd as one chain of jobs, steering toward the dock when seeking, then moving,
+//then finding the entities touching each other through the broad phase grid and checkCollision
+//Returns the touching pairs, candidates gets the pairs the grid put forward
+int updateEntities( Level& level, std::vector<EntityPair>& contacts, int& candidates );
+
+//Sets tiles from tile map
+bool setTiles( Level& level );
+
+//Adds entities walking about on open tiles, or heading for the dock
+void spawnCrowd( Level& level, int count );
+
+//Finds the first tile of a type, streamed worlds only have the chunks that are in, -1 if there is none
+int findTile( Level& level, int type );
+
+//Renders the tiles seen by the camera, returns the draw calls used
+int renderLevel( Level& level, SDL_Rect& camera );
+
+//Clears the screen and renders the level and entities, returns the draw calls used
+int renderFrame( Level& level, SDL_Rect& camera, float alpha );
+
+//Run time settings
+extern Options gOptions;
+
+//The window we'll be rendering to
+extern SDL_Window* gWindow;
+
+//The window renderer
+extern SDL_Renderer* gRenderer;
+
+//Scene textures
+extern LTexture gGambitTexture;
+extern Atlas gGambitAtlas;
+extern LTexture gTileTexture;
+extern Atlas gTileAtlas;
+
+//Batched tile geometry
+extern TileBatch gTileBatch;
+
+//Prerendered level chunks
+extern ChunkCache gChunkCache;
+
+//Per phase frame times
+extern FrameTimer gFrameTimer;
+
+//Background image decoding and map parsing
+extern AssetLoader gAssetLoader;
+
+//Shared textures by path
+extern TextureCache gTextureCache;
+
+//The player and everything else walking about
+extern EntityWorld gEntities;
+
+//Worker threads for the simulation
+extern JobSystem gJobs;
+
+//Routes over the level
+extern PathFinder gPaths;
+
+#endif
@@ -0,0 +1,470 @@
+#include "jobsystem.h"
+#include "trace.h"
+#include <stdio.h>
+
+//Queue of the thread running, workers get their own and every other thread shares the first
+static thread_local int tQueue = 0;
+
+JobSystem::JobSystem()
+{
+	//Initialize
+	SDL_AtomicSet( &mJobCount, 0 );
+	SDL_AtomicSet( &mQueued, 0 );
+	SDL_AtomicSet( &mStarted, 0 );
+	mGraphLock = NULL;
+	mBackgroundLock = NULL;
+	mSleepLock = NULL;
+	mWorkReady = NULL;
+	mQuit = false;
+}
+
+JobSystem::~JobSystem()
+{
+	//Deallocate
+	free();
+}
+
+bool JobSystem::init( int workers )
+{
+	//Get rid of preexisting workers
+	free();
+
+	mJobs.resize( MAX_JOBS );
+	mGraphLock = SDL_CreateMutex();
+	mBackgroundLock = SDL_CreateMutex();
+	mSleepLock = SDL_CreateMutex();
+	mWorkReady = SDL_CreateCond();
+	if( mGraphLock == NULL || mBackgroundLock == NULL || mSleepLock == NULL || mWorkReady == NULL )
+	{
+		printf( "Unable to create job system locks! SDL Error: %s\n", SDL_GetError() );
+		free();
+		return false;
+	}
+
+	//A queue for the waiting thread and each worker
+	workers = SDL_max( 0, SDL_min( workers, MAX_JOB_WORKERS ) );
+	mQueues.resize( workers + 1 );
+	for( size_t i = 0; i < mQueues.size(); ++i )
+	{
+		mQueues[ i ].lock = SDL_CreateMutex();
+		if( mQueues[ i ].lock == NULL )
+		{
+			printf( "Unable to create job queue lock! SDL Error: %s\n", SDL_GetError() );
+			free();
+			return false;
+		}
+	}
+
+	//Start the workers, running with fewer is fine
+	mQuit = false;
+	SDL_AtomicSet( &mStarted, 0 );
+	for( int i = 0; i < workers; ++i )
+	{
+		SDL_Thread* thread = SDL_CreateThread( workerMain, "job", this );
+		if( thread == NULL )
+		{
+			printf( "Unable to create job thread! SDL Error: %s\n", SDL_GetError() );
+			break;
+		}
+		mThreads.push_back( thread );
+	}
+
+	return true;
+}
+
+void JobSystem::free()
+{
+	//Let the workers drain the queues and stop
+	if( mSleepLock != NULL )
+	{
+		SDL_LockMutex( mSleepLock );
+		mQuit = true;
+		SDL_CondBroadcast( mWorkReady );
+		SDL_UnlockMutex( mSleepLock );
+	}
+	for( size_t i = 0; i < mThreads.size(); ++i )
+	{
+		SDL_WaitThread( mThreads[ i ], NULL );
+	}
+	mThreads.clear();
+
+	for( size_t i = 0; i < mQueues.size(); ++i )
+	{
+		if( mQueues[ i ].lock != NULL )
+		{
+			SDL_DestroyMutex( mQueues[ i ].lock );
+		}
+	}
+	mQueues.clear();
+
+	if( mGraphLock != NULL )
+	{
+		SDL_DestroyMutex( mGraphLock );
+		mGraphLock = NULL;
+	}
+	if( mBackgroundLock != NULL )
+	{
+		SDL_DestroyMutex( mBackgroundLock );
+		mBackgroundLock = NULL;
+	}
+	mBackground.clear();
+	if( mSleepLock != NULL )
+	{
+		SDL_DestroyMutex( mSleepLock );
+		mSleepLock = NULL;
+	}
+	if( mWorkReady != NULL )
+	{
+		SDL_DestroyCond( mWorkReady );
+		mWorkReady = NULL;
+	}
+
+	std::vector<Job>().swap( mJobs );
+	SDL_AtomicSet( &mJobCount, 0 );
+	SDL_AtomicSet( &mQueued, 0 );
+}
+
+JobHandle JobSystem::add( JobFunction function, void* data, int first, int last, const JobHandle* after, int afterCount )
+{
+	Job* job = allocate();
+	if( job == NULL )
+	{
+		//Out of storage or not started, so do it here and now
+		for( int i = 0; i < afterCount; ++i )
+		{
+			wait( after[ i ] );
+		}
+		function( first, last, data );
+		return NULL;
+	}
+
+	job->function = function;
+	job->data = data;
+	job->first = first;
+	job->last = last;
+	job->grain = 0;
+	return submit( job, after, afterCount );
+}
+
+JobHandle JobSystem::parallelFor( JobFunction function, void* data, int count, int grain, const JobHandle* after, int afterCount )
+{
+	Job* job = allocate();
+	if( job == NULL )
+	{
+		for( int i = 0; i < afterCount; ++i )
+		{
+			wait( after[ i ] );
+		}
+		function( 0, count, data );
+		return NULL;
+	}
+
+	//Splits when it runs, so the pieces don't sit in the queues waiting on what it comes after
+	job->function = function;
+	job->data = data;
+	job->first = 0;
+	job->last = count;
+	job->grain = SDL_max( grain, 1 );
+	return submit( job, after, afterCount );
+}
+
+bool JobSystem::addBackground( JobFunction function, void* data, int first, int last )
+{
+	if( mThreads.empty() )
+	{
+		return false;
+	}
+
+	BackgroundJob job = { function, data, first, last };
+	SDL_LockMutex( mBackgroundLock );
+	mBackground.push_back( job );
+	SDL_UnlockMutex( mBackgroundLock );
+	SDL_AtomicAdd( &mQueued, 1 );
+	wake( false );
+	return true;
+}
+
+void JobSystem::wait( JobHandle job )
+{
+	//Help out until the job is done
+	while( !isDone( job ) )
+	{
+		Job* next = take( tQueue );
+		if( next != NULL )
+		{
+			execute( next );
+		}
+		else
+		{
+			//The last pieces are running elsewhere
+			SDL_Delay( 0 );
+		}
+	}
+}
+
+void JobSystem::reset()
+{
+	SDL_AtomicSet( &mJobCount, 0 );
+}
+
+int JobSystem::workerMain( void* jobs )
+{
+	JobSystem* self = (JobSystem*)jobs;
+	tQueue = SDL_AtomicAdd( &self->mStarted, 1 ) + 1;
+	traceThreadName( "job" );
+
+	while( true )
+	{
+		//Run jobs while there are any to be had
+		Job* job = self->take( tQueue );
+		if( job != NULL )
+		{
+			self->execute( job );
+			continue;
+		}
+
+		//Then background work, looking for frame jobs again after each one
+		BackgroundJob background;
+		if( self->takeBackground( background ) )
+		{
+			TRACE_SCOPE( "JobSystem::background" );
+			background.function( background.first, background.last, background.data );
+			continue;
+		}
+
+		//Sleep until more are queued or the quit signal
+		SDL_LockMutex( self->mSleepLock );
+		while( SDL_AtomicGet( &self->mQueued ) == 0 && !self->mQuit )
+		{
+			SDL_CondWait( self->mWorkReady, self->mSleepLock );
+		}
+		bool quit = self->mQuit && SDL_AtomicGet( &self->mQueued ) == 0;
+		SDL_UnlockMutex( self->mSleepLock );
+
+		if( quit )
+		{
+			break;
+		}
+	}
+
+	return 0;
+}
+
+Job* JobSystem::allocate()
+{
+	if( mQueues.empty() )
+	{
+		return NULL;
+	}
+
+	int index = SDL_AtomicAdd( &mJobCount, 1 );
+	if( index >= MAX_JOBS )
+	{
+		return NULL;
+	}
+
+	Job* job = &mJobs[ index ];
+	SDL_AtomicSet( &job->unfinished, 1 );
+	job->closed = false;
+	SDL_AtomicSet( &job->done, 0 );
+	job->parent = NULL;
+	job->dependents.clear();
+	return job;
+}
+
+JobHandle JobSystem::submit( Job* job, const JobHandle* after, int afterCount )
+{
+	//Hold the job back until it's hooked up to everything it comes after
+	SDL_AtomicSet( &job->blockers, afterCount + 1 );
+	for( int i = 0; i < afterCount; ++i )
+	{
+		bool waiting = false;
+		if( after[ i ] != NULL )
+		{
+			SDL_LockMutex( mGraphLock );
+			if( !after[ i ]->closed )
+			{
+				after[ i ]->dependents.push_back( job );
+				waiting = true;
+			}
+			SDL_UnlockMutex( mGraphLock );
+		}
+
+		if( !waiting )
+		{
+			SDL_AtomicAdd( &job->blockers, -1 );
+		}
+	}
+
+	release( job );
+	return job;
+}
+
+void JobSystem::release( Job* job )
+{
+	if( SDL_AtomicAdd( &job->blockers, -1 ) == 1 )
+	{
+		push( job );
+		wake( false );
+	}
+}
+
+void JobSystem::push( Job* job )
+{
+	Queue& queue = mQueues[ tQueue ];
+	SDL_LockMutex( queue.lock );
+	queue.jobs.push_back( job );
+	SDL_UnlockMutex( queue.lock );
+	SDL_AtomicAdd( &mQueued, 1 );
+}
+
+void JobSystem::wake( bool all )
+{
+	if( mThreads.empty() )
+	{
+		return;
+	}
+
+	//Taking the lock means no worker is between checking for work and sleeping
+	SDL_LockMutex( mSleepLock );
+	if( all )
+	{
+		SDL_CondBroadcast( mWorkReady );
+	}
+	else
+	{
+		SDL_CondSignal( mWorkReady );
+	}
+	SDL_UnlockMutex( mSleepLock );
+}
+
+Job* JobSystem::take( int queue )
+{
+	//Newest first from our own queue, it's most likely still in cache
+	Job* job = NULL;
+	Queue& own = mQueues[ queue ];
+	SDL_LockMutex( own.lock );
+	if( !own.jobs.empty() )
+	{
+		job = own.jobs.back();
+		own.jobs.pop_back();
+	}
+	SDL_UnlockMutex( own.lock );
+
+	//Oldest first from the others, it's likely the biggest piece of work
+	for( size_t i = 1; job == NULL && i < mQueues.size(); ++i )
+	{
+		Queue& victim = mQueues[ ( queue + i ) % mQueues.size() ];
+		SDL_LockMutex( victim.lock );
+		if( !victim.jobs.empty() )
+		{
+			job = victim.jobs.front();
+			victim.jobs.pop_front();
+		}
+		SDL_UnlockMutex( victim.lock );
+	}
+
+	if( job != NULL )
+	{
+		SDL_AtomicAdd( &mQueued, -1 );
+	}
+	return job;
+}
+
+bool JobSystem::takeBackground( BackgroundJob& job )
+{
+	bool taken = false;
+	SDL_LockMutex( mBackgroundLock );
+	if( !mBackground.empty() )
+	{
+		job = mBackground.front();
+		mBackground.pop_front();
+		taken = true;
+	}
+	SDL_UnlockMutex( mBackgroundLock );
+
+	if( taken )
+	{
+		SDL_AtomicAdd( &mQueued, -1 );
+	}
+	return taken;
+}
+
+void JobSystem::execute( Job* job )
+{
+	if( job->grain > 0 )
+	{
+		TRACE_SCOPE( "JobSystem::split" );
+
+		//Queue every piece but the first, which runs right here
+		int split = job->first + job->grain;
+		int queued = 0;
+		for( int first = split; first < job->last; first += job->grain )
+		{
+			Job* piece = allocate();
+			if( piece == NULL )
+			{
+				break;
+			}
+			piece->function = job->function;
+			piece->data = job->data;
+			piece->first = first;
+			piece->last = SDL_min( first + job->grain, job->last );
+			piece->grain = 0;
+			piece->parent = job;
+			SDL_AtomicSet( &piece->blockers, 0 );
+
+			//Count it before anyone can finish it
+			SDL_AtomicAdd( &job->unfinished, 1 );
+			push( piece );
+			queued++;
+			split = piece->last;
+		}
+		if( queued > 0 )
+		{
+			wake( true );
+		}
+
+		//Pieces there was no room for run here too
+		job->function( job->first, SDL_min( job->first + job->grain, job->last ), job->data );
+		if( split < job->last )
+		{
+			job->function( split, job->last, job->data );
+		}
+	}
+	else
+	{
+		job->function( job->first, job->last, job->data );
+	}
+
+	finish( job );
+}
+
+void JobSystem::finish( Job* job )
+{
+	//Pieces still running
+	if( SDL_AtomicAdd( &job->unfinished, -1 ) != 1 )
+	{
+		return;
+	}
+
+	//Nothing can be added to the dependents once it's closed
+	std::vector<Job*> dependents;
+	SDL_LockMutex( mGraphLock );
+	job->closed = true;
+	dependents.swap( job->dependents );
+	SDL_UnlockMutex( mGraphLock );
+
+	//Once it's marked done the storage can be reset under us, so nothing reads the job after this
+	Job* parent = job->parent;
+	SDL_AtomicSet( &job->done, 1 );
+
+	for( size_t i = 0; i < dependents.size(); ++i )
+	{
+		release( dependents[ i ] );
+	}
+	if( parent != NULL )
+	{
+		finish( parent );
+	}
+}
@@ -0,0 +1,159 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+#include <deque>
+
+//Most jobs, counting parallel for pieces, between resets
+const int MAX_JOBS = 4096;
+
+//Most worker threads
+const int MAX_JOB_WORKERS = 15;
+
+//Does the work for items first to last - 1
+typedef void (*JobFunction)( int first, int last, void* data );
+
+//A queued piece of work, kept in the job system's storage until it's reset
+struct Job
+{
+	//The work and its item range
+	JobFunction function;
+	void* data;
+	int first;
+	int last;
+
+	//Items per piece when the job is a parallel for, 0 for a plain job
+	int grain;
+
+	//Unfinished jobs it comes after, plus one while it's being set up
+	SDL_atomic_t blockers;
+
+	//The job itself and its unfinished pieces
+	SDL_atomic_t unfinished;
+
+	//Set under the graph lock once the job and its pieces have run, so no more dependents get added
+	bool closed;
+
+	//Set once its dependents have been taken, nothing touches the job after that
+	SDL_atomic_t done;
+
+	//Job it's a piece of, and jobs that come after it
+	Job* parent;
+	std::vector<Job*> dependents;
+};
+
+//Identifies a queued job, NULL for one that already ran
+typedef Job* JobHandle;
+
+//Runs jobs on worker threads that each keep a queue and steal from the others when theirs runs dry
+//The thread that adds jobs helps run them while it waits, so SDL calls stay on it and around the jobs
+class JobSystem
+{
+	public:
+		//Initializes variables
+		JobSystem();
+
+		//Stops the workers
+		~JobSystem();
+
+		//Starts worker threads, 0 runs every job on the waiting thread
+		bool init( int workers );
+
+		//Waits for queued jobs and stops the workers
+		void free();
+
+		//Queues a job over items first to last - 1 to run once the jobs it comes after have finished
+		JobHandle add( JobFunction function, void* data, int first, int last, const JobHandle* after = NULL, int afterCount = 0 );
+
+		//Queues a job that splits count items into pieces of grain items run in parallel, finishing with the last piece
+		JobHandle parallelFor( JobFunction function, void* data, int count, int grain, const JobHandle* after = NULL, int afterCount = 0 );
+
+		//Queues a job for the workers to pick up once they're out of other work, it can run across frames and resets
+		//since it isn't kept in the job storage, and the waiting thread never takes it, so long work doesn't hold up a frame
+		//The job says when it's done itself, false if there are no workers to run it
+		bool addBackground( JobFunction function, void* data, int first, int last );
+
+		//Runs jobs until the given one has finished
+		void wait( JobHandle job );
+
+		//Whether a job has finished
+		bool isDone( JobHandle job ) { return job == NULL || SDL_AtomicGet( &job->done ) != 0; }
+
+		//Recycles job storage, every job added must have finished
+		void reset();
+
+		//Gets the threads running jobs, the waiting thread included
+		int getThreadCount() { return (int)mThreads.size() + 1; }
+
+	private:
+		//A thread's queue, the owner works from the back and thieves take from the front
+		struct Queue
+		{
+			std::deque<Job*> jobs;
+			SDL_mutex* lock;
+		};
+
+		//Background work, kept apart from the job storage
+		struct BackgroundJob
+		{
+			JobFunction function;
+			void* data;
+			int first;
+			int last;
+		};
+
+		//Worker thread entry point
+		static int workerMain( void* jobs );
+
+		//Takes a job from the storage, NULL when it's used up
+		Job* allocate();
+
+		//Sets up a job's dependencies and queues it if it has none left
+		JobHandle submit( Job* job, const JobHandle* after, int afterCount );
+
+		//Lets a job go once the last job it comes after finishes
+		void release( Job* job );
+
+		//Queues a ready job on the current thread's queue
+		void push( Job* job );
+
+		//Wakes sleeping workers
+		void wake( bool all );
+
+		//Takes a job from a thread's own queue, or steals one, NULL if there are none
+		Job* take( int queue );
+
+		//Takes the oldest background job, false if there are none
+		bool takeBackground( BackgroundJob& job );
+
+		//Runs a job, or splits it into pieces
+		void execute( Job* job );
+
+		//Counts a job or piece as finished, finishing its parent and releasing its dependents
+		void finish( Job* job );
+
+		//Job storage and how much of it is in use
+		std::vector<Job> mJobs;
+		SDL_atomic_t mJobCount;
+
+		//Queues by thread, the waiting thread's first, and background jobs, all counted together
+		std::vector<Queue> mQueues;
+		std::deque<BackgroundJob> mBackground;
+		SDL_mutex* mBackgroundLock;
+		SDL_atomic_t mQueued;
+
+		//Guards dependents lists against jobs finishing
+		SDL_mutex* mGraphLock;
+
+		//Idle workers sleep here
+		SDL_mutex* mSleepLock;
+		SDL_cond* mWorkReady;
+		bool mQuit;
+
+		//Worker threads, and how many have picked a queue
+		std::vector<SDL_Thread*> mThreads;
+		SDL_atomic_t mStarted;
+};
+
+#endif
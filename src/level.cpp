@@ -0,0 +1,539 @@
+#include "level.h"
+#include "mapformat.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+Level::Level()
+{
+	//Initialize
+	mTiles = NULL;
+	mMapping = NULL;
+	mMappingSize = 0;
+	mStream = NULL;
+	mLoaded = NULL;
+	mLoadedData = NULL;
+	mSolidVersion = 0;
+	mRegionShift = SOLID_REGION_SHIFT;
+	mRegionColumns = 0;
+	mRegionRows = 0;
+	mColumns = 0;
+	mRows = 0;
+	mLayers = 0;
+}
+
+Level::~Level()
+{
+	//Deallocate
+	free();
+}
+
+bool Level::loadFromFile( std::string path )
+{
+	//Get rid of preexisting tiles
+	free();
+
+	//Peek at the start of the file
+	FILE* file = fopen( path.c_str(), "rb" );
+	if( file == NULL )
+	{
+		printf( "Unable to load map file %s!\n", path.c_str() );
+		return false;
+	}
+	char magic[ sizeof( MAP_MAGIC ) ];
+	bool read = fread( magic, 1, sizeof( magic ), file ) == sizeof( magic );
+	fclose( file );
+
+	//Binary maps are used as they are on disk, worlds are streamed from it
+	bool loaded = false;
+	if( read && memcmp( magic, MAP_MAGIC, sizeof( magic ) ) == 0 )
+	{
+		loaded = loadBinary( path );
+	}
+	else if( read && memcmp( magic, WORLD_MAGIC, sizeof( magic ) ) == 0 )
+	{
+		loaded = loadWorld( path );
+	}
+	else
+	{
+		loaded = loadText( path );
+	}
+
+	//Mark the walls, streamed chunks get theirs as they arrive
+	if( loaded )
+	{
+		mSolid.init( mColumns, mRows );
+		mSolidVersion++;
+
+		//A region per chunk when streaming, so a chunk arriving touches just the one
+		mRegionShift = mStream != NULL ? mStream->getChunkShift() : SOLID_REGION_SHIFT;
+		mRegionColumns = ( mColumns + ( 1 << mRegionShift ) - 1 ) >> mRegionShift;
+		mRegionRows = ( mRows + ( 1 << mRegionShift ) - 1 ) >> mRegionShift;
+		mRegionVersions.assign( (size_t)mRegionColumns * mRegionRows, 0 );
+		if( mStream == NULL )
+		{
+			markSolid( 0, 0, mColumns - 1, mRows - 1 );
+		}
+	}
+
+	return loaded;
+}
+
+bool Level::loadText( std::string path )
+{
+	//Open the map
+	std::ifstream map( path.c_str() );
+
+	//If the map couldn't be loaded
+	if( !map.is_open() )
+	{
+		printf( "Unable to load map file %s!\n", path.c_str() );
+		return false;
+	}
+
+	//Read the map row by row, its width comes from the first row
+	std::string line;
+	int columns = 0;
+	int rows = 0;
+	while( std::getline( map, line ) )
+	{
+		const char* next = line.c_str();
+		int count = 0;
+
+		//Read the tile numbers on this row
+		while( true )
+		{
+			char* end;
+			long tileType = strtol( next, &end, 10 );
+
+			//If there are no more numbers
+			if( end == next )
+			{
+				break;
+			}
+
+			//If we don't recognize the tile type
+			if( ( tileType < 0 ) || ( tileType >= TOTAL_TILE_SPRITES ) )
+			{
+				printf( "Error loading map: Invalid tile type at %d!\n", (int)mOwned.size() );
+				free();
+				return false;
+			}
+
+			mOwned.push_back( (Uint8)tileType );
+			next = end;
+			count++;
+		}
+
+		//If the row has something other than tile numbers
+		while( *next == ' ' || *next == '\t' || *next == '\r' )
+		{
+			next++;
+		}
+		if( *next != '\0' )
+		{
+			printf( "Error loading map: Unexpected text on row %d!\n", rows + 1 );
+			free();
+			return false;
+		}
+
+		//Skip blank lines
+		if( count == 0 )
+		{
+			continue;
+		}
+
+		//Every row must be as wide as the first
+		if( columns == 0 )
+		{
+			columns = count;
+		}
+		else if( count != columns )
+		{
+			printf( "Error loading map: Row %d has %d tiles, expected %d!\n", rows + 1, count, columns );
+			free();
+			return false;
+		}
+		rows++;
+	}
+
+	//Close the file
+	map.close();
+
+	//If the map had no tiles
+	if( rows == 0 )
+	{
+		printf( "Error loading map: Unexpected end of file!\n" );
+		free();
+		return false;
+	}
+
+	mTiles = &mOwned[ 0 ];
+	mColumns = columns;
+	mRows = rows;
+	mLayers = 1;
+
+	return true;
+}
+
+bool Level::loadBinary( std::string path )
+{
+	//Open the map
+	int file = open( path.c_str(), O_RDONLY );
+	if( file < 0 )
+	{
+		printf( "Unable to load map file %s! %s\n", path.c_str(), strerror( errno ) );
+		return false;
+	}
+
+	//Map the whole file
+	struct stat info;
+	void* mapping = MAP_FAILED;
+	if( fstat( file, &info ) == 0 && info.st_size >= (off_t)sizeof( MapHeader ) )
+	{
+		mapping = mmap( NULL, info.st_size, PROT_READ, MAP_PRIVATE, file, 0 );
+	}
+	close( file );
+
+	if( mapping == MAP_FAILED )
+	{
+		printf( "Unable to map map file %s!\n", path.c_str() );
+		return false;
+	}
+	mMapping = mapping;
+	mMappingSize = info.st_size;
+
+	//Check the header
+	const MapHeader* header = (const MapHeader*)mapping;
+	size_t layerSize = (size_t)header->columns * header->rows;
+	if( header->version != MAP_VERSION )
+	{
+		printf( "Error loading map: Unsupported version %u!\n", header->version );
+	}
+	else if( header->tileWidth != TILE_WIDTH || header->tileHeight != TILE_HEIGHT )
+	{
+		printf( "Error loading map: Tile size %ux%u doesn't match the tile set!\n", header->tileWidth, header->tileHeight );
+	}
+	else if( header->columns == 0 || header->rows == 0 || header->layers == 0 || header->dataOffset < sizeof( MapHeader ) || header->dataOffset > mMappingSize || ( mMappingSize - header->dataOffset ) / header->layers < layerSize )
+	{
+		printf( "Error loading map: Bad dimensions or truncated file!\n" );
+	}
+	else
+	{
+		//Check the tiles
+		const Uint8* tiles = (const Uint8*)mapping + header->dataOffset;
+		size_t dataSize = layerSize * header->layers;
+		if( mapChecksum( tiles, dataSize ) != header->checksum )
+		{
+			printf( "Error loading map: Checksum mismatch!\n" );
+		}
+		else
+		{
+			size_t i = 0;
+			while( i < dataSize && tiles[ i ] < TOTAL_TILE_SPRITES )
+			{
+				i++;
+			}
+
+			if( i < dataSize )
+			{
+				printf( "Error loading map: Invalid tile type at %d!\n", (int)( i % layerSize ) );
+			}
+			else
+			{
+				//Use the tiles straight from the mapping
+				mTiles = tiles;
+				mColumns = header->columns;
+				mRows = header->rows;
+				mLayers = header->layers;
+				return true;
+			}
+		}
+	}
+
+	//Don't keep a bad map
+	free();
+	return false;
+}
+
+bool Level::loadWorld( std::string path )
+{
+	mStream = new WorldStream;
+	if( !mStream->open( path, TOTAL_TILE_SPRITES ) )
+	{
+		free();
+		return false;
+	}
+
+	if( mStream->getTileWidth() != TILE_WIDTH || mStream->getTileHeight() != TILE_HEIGHT )
+	{
+		printf( "Error loading world: Tile size %dx%d doesn't match the tile set!\n", mStream->getTileWidth(), mStream->getTileHeight() );
+		free();
+		return false;
+	}
+
+	//Tiles come from the stream, chunk by chunk
+	mStream->setLoadedCallback( streamLoaded, this );
+	mColumns = mStream->getColumns();
+	mRows = mStream->getRows();
+	mLayers = 1;
+	return true;
+}
+
+bool Level::compress()
+{
+	//Streamed and already compressed tiles aren't all there to encode
+	if( mTiles == NULL )
+	{
+		return false;
+	}
+
+	if( !mRuns.build( mTiles, mColumns, mRows ) )
+	{
+		return false;
+	}
+	releaseTiles();
+	return true;
+}
+
+void Level::releaseTiles()
+{
+	//Release the mapped file
+	if( mMapping != NULL )
+	{
+		munmap( mMapping, mMappingSize );
+		mMapping = NULL;
+		mMappingSize = 0;
+	}
+
+	//Release the parsed tiles
+	std::vector<Uint8>().swap( mOwned );
+	mTiles = NULL;
+}
+
+void Level::free()
+{
+	releaseTiles();
+	mRuns.free();
+	mSolid.free();
+	mRegionVersions.clear();
+	mRegionColumns = 0;
+	mRegionRows = 0;
+
+	//Stop streaming
+	delete mStream;
+	mStream = NULL;
+
+	mColumns = 0;
+	mRows = 0;
+	mLayers = 0;
+}
+
+SDL_Rect Level::getBox( int index )
+{
+	//Tile position follows from its place in the grid
+	SDL_Rect box = { ( index % mColumns ) * TILE_WIDTH, ( index / mColumns ) * TILE_HEIGHT, TILE_WIDTH, TILE_HEIGHT };
+	return box;
+}
+
+bool Level::getTileSpan( SDL_Rect box, int& firstCol, int& firstRow, int& lastCol, int& lastRow )
+{
+	//Clip the box to the level
+	int left = box.x < 0 ? 0 : box.x;
+	int top = box.y < 0 ? 0 : box.y;
+	int right = box.x + box.w > getWidth() ? getWidth() : box.x + box.w;
+	int bottom = box.y + box.h > getHeight() ? getHeight() : box.y + box.h;
+
+	//If nothing of the box is inside the level
+	if( right <= left || bottom <= top )
+	{
+		return false;
+	}
+
+	//Edges are exclusive, so a box ending on a tile border stops at the tile before it
+	firstCol = left / TILE_WIDTH;
+	firstRow = top / TILE_HEIGHT;
+	lastCol = ( right - 1 ) / TILE_WIDTH;
+	lastRow = ( bottom - 1 ) / TILE_HEIGHT;
+
+	return true;
+}
+
+bool Level::sweep( SDL_Rect& box, int dx, int dy, TileHit& hit )
+{
+	//One axis at a time, so a box blocked on one still slides along the other
+	hit.moveX = sweepAxis( box.x, box.w, box.y, box.h, dx, false, hit.normalX );
+	box.x += hit.moveX;
+	hit.moveY = sweepAxis( box.y, box.h, box.x, box.w, dy, true, hit.normalY );
+	box.y += hit.moveY;
+
+	return hit.normalX != 0 || hit.normalY != 0;
+}
+
+int Level::sweepAxis( int start, int size, int acrossStart, int acrossSize, int delta, bool vertical, int& normal )
+{
+	normal = 0;
+	if( delta == 0 )
+	{
+		return 0;
+	}
+
+	int tileSize = vertical ? TILE_HEIGHT : TILE_WIDTH;
+	int acrossTileSize = vertical ? TILE_WIDTH : TILE_HEIGHT;
+	int extent = vertical ? getHeight() : getWidth();
+	int acrossCells = vertical ? mColumns : mRows;
+
+	//The level edges stop it before any tile does
+	if( delta > 0 && start + size + delta > extent )
+	{
+		delta = SDL_max( extent - start - size, 0 );
+		normal = -1;
+	}
+	else if( delta < 0 && start + delta < 0 )
+	{
+		delta = SDL_min( -start, 0 );
+		normal = 1;
+	}
+
+	//Tiles the box covers across the way it moves, edges are exclusive
+	int firstCell = SDL_max( acrossStart / acrossTileSize, 0 );
+	int lastCell = SDL_min( ( acrossStart + acrossSize - 1 ) / acrossTileSize, acrossCells - 1 );
+
+	//Lines of tiles the leading edge enters, so the cost goes with the distance
+	int step = delta > 0 ? 1 : -1;
+	int firstLine = delta > 0 ? ( start + size - 1 ) / tileSize + 1 : start / tileSize - 1;
+	int lastLine = delta > 0 ? ( start + size + delta - 1 ) / tileSize : ( start + delta ) / tileSize;
+	int hitLine = -1;
+	if( vertical )
+	{
+		//Rows nearest first, each a span of the mask
+		for( int line = firstLine; line * step <= lastLine * step; line += step )
+		{
+			if( mSolid.anyInRow( line, firstCell, lastCell ) )
+			{
+				hitLine = line;
+				break;
+			}
+		}
+	}
+	else if( firstLine * step <= lastLine * step )
+	{
+		//The nearest wall column in each row the box covers, a word of columns at a time
+		int low = SDL_min( firstLine, lastLine );
+		int high = SDL_max( firstLine, lastLine );
+		for( int cell = firstCell; cell <= lastCell; ++cell )
+		{
+			int col = step > 0 ? mSolid.findInRow( cell, low, high ) : mSolid.findLastInRow( cell, low, high );
+			if( col >= 0 )
+			{
+				//The rows left only need looking at up to this one
+				hitLine = col;
+				if( step > 0 )
+				{
+					high = col - 1;
+				}
+				else
+				{
+					low = col + 1;
+				}
+			}
+		}
+	}
+
+	//Stop flush against the wall
+	if( hitLine >= 0 )
+	{
+		normal = -step;
+		return delta > 0 ? hitLine * tileSize - start - size : ( hitLine + 1 ) * tileSize - start;
+	}
+
+	return delta;
+}
+
+bool Level::visitRuns( int row, int firstCol, int lastCol, RunVisitor visit, void* data )
+{
+	//Compressed rows hand over whole runs, so scanning a big level costs a visit per run rather than per tile
+	for( int col = firstCol, end; col <= lastCol; col = end )
+	{
+		int type = getRun( col, row, end );
+		if( !visit( row, col, SDL_min( end - 1, lastCol ), type, data ) )
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+//The solid mask being marked and whether a tile in the region flipped
+struct SolidRuns
+{
+	TileMask* solid;
+	bool changed;
+};
+
+//Marks whether a stretch of tiles blocks movement
+static bool markRun( int row, int firstCol, int lastCol, int type, void* data )
+{
+	SolidRuns* runs = (SolidRuns*)data;
+	bool solid = getTileTraits( type ).solid;
+	for( int col = firstCol; col <= lastCol; ++col )
+	{
+		runs->changed = runs->changed || runs->solid->test( col, row ) != solid;
+		runs->solid->set( col, row, solid );
+	}
+
+	return true;
+}
+
+void Level::markSolid( int firstCol, int firstRow, int lastCol, int lastRow )
+{
+	//A region at a time, so each knows whether anything in it changed
+	for( int regionRow = firstRow >> mRegionShift; regionRow <= lastRow >> mRegionShift; ++regionRow )
+	{
+		for( int regionCol = firstCol >> mRegionShift; regionCol <= lastCol >> mRegionShift; ++regionCol )
+		{
+			//The first tiles to arrive change what the region costs to walk even without walls
+			int region = regionRow * mRegionColumns + regionCol;
+			bool changed = mRegionVersions[ region ] == 0;
+			int top = SDL_max( firstRow, regionRow << mRegionShift );
+			int bottom = SDL_min( lastRow, ( ( regionRow + 1 ) << mRegionShift ) - 1 );
+			int left = SDL_max( firstCol, regionCol << mRegionShift );
+			int right = SDL_min( lastCol, ( ( regionCol + 1 ) << mRegionShift ) - 1 );
+			SolidRuns runs = { &mSolid, changed };
+			for( int row = top; row <= bottom; ++row )
+			{
+				visitRuns( row, left, right, markRun, &runs );
+			}
+			changed = runs.changed;
+
+			//Chunks streaming back in with the walls they left with change nothing
+			if( changed )
+			{
+				mRegionVersions[ region ]++;
+				mSolidVersion++;
+			}
+		}
+	}
+}
+
+void Level::streamLoaded( int firstCol, int firstRow, int lastCol, int lastRow, void* data )
+{
+	Level* level = (Level*)data;
+	level->markSolid( firstCol, firstRow, lastCol, lastRow );
+	if( level->mLoaded != NULL )
+	{
+		level->mLoaded( firstCol, firstRow, lastCol, lastRow, level->mLoadedData );
+	}
+}
+
+size_t Level::getMemoryUsage()
+{
+	return sizeof( Level ) + mOwned.capacity() * sizeof( Uint8 ) + mMappingSize + mRuns.getMemoryUsage() + mSolid.getMemoryUsage() + ( mStream != NULL ? mStream->getMemoryUsage() : 0 );
+}
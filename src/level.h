@@ -0,0 +1,195 @@
+#ifndef LEVEL_H
+#define LEVEL_H
+
+#include <SDL2/SDL.h>
+#include <string>
+#include <vector>
+#include "worldstream.h"
+#include "tileruns.h"
+#include "tiletraits.h"
+#include "tilemask.h"
+
+//tile constants
+const int TILE_WIDTH = 80;
+const int TILE_HEIGHT = 80;
+
+//Side of the square regions solid changes are tracked in as a power of two, streamed worlds use their chunk side
+const int SOLID_REGION_SHIFT = 5;
+
+//How far a box swept across the tiles got
+struct TileHit
+{
+	//Pixels moved on each axis
+	int moveX;
+	int moveY;
+
+	//Direction back out of whatever stopped the box on each axis, 0 if nothing did
+	int normalX;
+	int normalY;
+};
+
+//Told about each stretch of one tile type Level::visitRuns walks over, its columns inclusive, false stops the walk
+typedef bool (*RunVisitor)( int row, int firstCol, int lastCol, int type, void* data );
+
+//The tile map, one byte per tile stored row by row
+//Binary maps are memory mapped and used in place, text maps are parsed into memory,
+//chunked worlds are streamed in around the camera, and maps can be compressed into runs of the same tile
+class Level
+{
+	public:
+		//Initializes an empty level
+		Level();
+
+		//Deallocates memory
+		~Level();
+
+		//Loads tile types from a binary or text map
+		bool loadFromFile( std::string path );
+
+		//Deallocates tiles
+		void free();
+
+		//Swaps the tiles for run length encoded ones, false if they aren't all in memory
+		bool compress();
+
+		//Whether the tiles are run length encoded
+		bool isCompressed() { return !mRuns.isEmpty(); }
+
+		//Gets the tile type at an index or grid cell
+		int getType( int index ) { return mTiles != NULL ? mTiles[ index ] : getSparseType( index % mColumns, index / mColumns ); }
+		int getType( int col, int row ) { return mTiles != NULL ? mTiles[ row * mColumns + col ] : getSparseType( col, row ); }
+
+		//Gets the tile type at a grid cell and the column just past the stretch of that type holding it,
+		//so renderers can walk compressed rows a run at a time
+		int getRun( int col, int row, int& end )
+		{
+			if( mTiles == NULL && mStream == NULL )
+			{
+				return mRuns.getRun( col, row, end );
+			}
+			end = col + 1;
+			return getType( col, row );
+		}
+
+		//Walks a row from firstCol to lastCol a stretch of one tile type at a time, clipped to those columns
+		//Returns false if the visitor stopped it early
+		bool visitRuns( int row, int firstCol, int lastCol, RunVisitor visit, void* data );
+
+		//Streams the chunks of a chunked world around the camera, nothing for other maps
+		void updateStreaming( const SDL_Rect& camera ) { if( mStream != NULL ) mStream->update( camera ); }
+
+		//Waits for the chunks under the camera to stream in
+		void waitForStreaming( const SDL_Rect& camera ) { if( mStream != NULL ) mStream->wait( camera ); }
+
+		//Gets the world stream, NULL unless the level is a chunked world
+		WorldStream* getStream() { return mStream; }
+
+		//Sets the function told about streamed chunks arriving, after their walls are marked
+		void setLoadedCallback( ChunkLoaded callback, void* data ) { mLoaded = callback; mLoadedData = data; }
+
+		//Whether the tile at a grid cell blocks movement
+		bool isSolid( int col, int row ) { return mSolid.test( col, row ); }
+
+		//Whether any tile in a range of grid cells blocks movement
+		bool anySolid( int firstCol, int firstRow, int lastCol, int lastRow ) { return mSolid.anyInArea( firstCol, firstRow, lastCol, lastRow ); }
+
+		//Gets the bit per cell of the tiles that block movement
+		//Streamed chunks are marked as they arrive and stay marked, so the crowd out of view keeps to the walls
+		TileMask& getSolidMask() { return mSolid; }
+
+		//Gets a count that goes up whenever a region's version does
+		Uint32 getSolidVersion() { return mSolidVersion; }
+
+		//Gets a count that goes up when a region's solid tiles change or its tiles first stream in,
+		//so cached routes over it know to start over and the ones elsewhere can stay
+		Uint32 getRegionVersion( int region ) { return mRegionVersions[ region ]; }
+
+		//Gets the region side in tiles as a power of two, and the regions across and down the level
+		int getRegionShift() { return mRegionShift; }
+		int getRegionColumns() { return mRegionColumns; }
+		int getRegionRows() { return mRegionRows; }
+
+		//Gets the collision box of the tile at an index
+		SDL_Rect getBox( int index );
+
+		//Gets the range of tile columns and rows a box covers, false if it covers none
+		bool getTileSpan( SDL_Rect box, int& firstCol, int& firstRow, int& lastCol, int& lastRow );
+
+		//Moves a box inside the level by dx then dy pixels, stopping it flush against the first wall or level edge
+		//on each axis so it slides along the other, only looking at the tiles its leading edge crosses
+		//Returns whether anything was hit
+		bool sweep( SDL_Rect& box, int dx, int dy, TileHit& hit );
+
+		//Gets level dimensions
+		int getColumns() { return mColumns; }
+		int getRows() { return mRows; }
+		int getTotalTiles() { return mColumns * mRows; }
+		int getWidth() { return mColumns * TILE_WIDTH; }
+		int getHeight() { return mRows * TILE_HEIGHT; }
+		int getLayers() { return mLayers; }
+
+		//Gets the bytes used by the level
+		size_t getMemoryUsage();
+
+	private:
+		//Parses a text map, one row of tile numbers per line
+		bool loadText( std::string path );
+
+		//Maps a binary map file into memory
+		bool loadBinary( std::string path );
+
+		//Opens a chunked world for streaming
+		bool loadWorld( std::string path );
+
+		//Releases the tiles held in memory or mapped from the file
+		void releaseTiles();
+
+		//Gets how far a box can move along one axis before the tiles across it block the way, and the hit normal
+		int sweepAxis( int start, int size, int acrossStart, int acrossSize, int delta, bool vertical, int& normal );
+
+		//Marks the solid tiles in a range of grid cells
+		void markSolid( int firstCol, int firstRow, int lastCol, int lastRow );
+
+		//Marks the walls of a streamed chunk and passes it on
+		static void streamLoaded( int firstCol, int firstRow, int lastCol, int lastRow, void* data );
+
+		//Gets a tile type from the stream or the runs
+		int getSparseType( int col, int row ) { return mStream != NULL ? mStream->getType( col, row ) : mRuns.getType( col, row ); }
+
+		//The tile types of the first layer
+		const Uint8* mTiles;
+
+		//Tile storage for text maps
+		std::vector<Uint8> mOwned;
+
+		//The mapped file for binary maps
+		void* mMapping;
+		size_t mMappingSize;
+
+		//The streamed chunks of a chunked world
+		WorldStream* mStream;
+
+		//The tiles of a compressed map
+		TileRuns mRuns;
+
+		//Tiles that block movement, and how many times they've changed
+		TileMask mSolid;
+		Uint32 mSolidVersion;
+
+		//Changes by region, 0 for a region that hasn't been marked yet
+		std::vector<Uint32> mRegionVersions;
+		int mRegionShift;
+		int mRegionColumns;
+		int mRegionRows;
+
+		//Told about streamed chunks arriving
+		ChunkLoaded mLoaded;
+		void* mLoadedData;
+
+		//Level dimensions in tiles
+		int mColumns;
+		int mRows;
+		int mLayers;
+};
+
+#endif
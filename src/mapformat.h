@@ -0,0 +1,106 @@
+#ifndef MAPFORMAT_H
+#define MAPFORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+//Binary map files start with this tag
+const char MAP_MAGIC[ 4 ] = { 'R', 'K', 'M', 'P' };
+
+//Current binary map version
+const uint32_t MAP_VERSION = 1;
+
+//Binary map file header, stored little endian and followed by the tile layers
+//Each layer is columns * rows tile types, one byte per tile, row by row
+struct MapHeader
+{
+	//MAP_MAGIC
+	char magic[ 4 ];
+
+	//MAP_VERSION
+	uint32_t version;
+
+	//Map dimensions in tiles
+	uint32_t columns;
+	uint32_t rows;
+
+	//Tile dimensions in pixels
+	uint16_t tileWidth;
+	uint16_t tileHeight;
+
+	//Number of tile layers
+	uint32_t layers;
+
+	//FNV-1a hash of all the layer bytes
+	uint32_t checksum;
+
+	//Offset of the first layer from the start of the file
+	uint32_t dataOffset;
+};
+
+static_assert( sizeof( MapHeader ) == 32, "MapHeader must stay 32 bytes" );
+
+//Chunked world files start with this tag
+const char WORLD_MAGIC[ 4 ] = { 'R', 'K', 'W', 'D' };
+
+//Current chunked world version
+const uint32_t WORLD_VERSION = 1;
+
+//Chunked world file header, stored little endian and followed by the chunk index
+//The world is cut into square chunks of chunkTiles tiles a side, numbered row by row,
+//edge chunks are padded to full size so each holds chunkTiles * chunkTiles bytes per layer
+struct WorldHeader
+{
+	//WORLD_MAGIC
+	char magic[ 4 ];
+
+	//WORLD_VERSION
+	uint32_t version;
+
+	//World dimensions in tiles
+	uint32_t columns;
+	uint32_t rows;
+
+	//Tile dimensions in pixels
+	uint16_t tileWidth;
+	uint16_t tileHeight;
+
+	//Chunk side in tiles, and number of tile layers
+	uint16_t chunkTiles;
+	uint16_t layers;
+
+	//Offset of the chunk index from the start of the file
+	uint32_t indexOffset;
+
+	//Zero
+	uint32_t reserved;
+};
+
+static_assert( sizeof( WorldHeader ) == 32, "WorldHeader must stay 32 bytes" );
+
+//Where a chunk's tiles are in a world file
+struct WorldChunk
+{
+	//Offset from the start of the file and size in bytes
+	uint64_t offset;
+	uint32_t size;
+
+	//mapChecksum of the chunk bytes
+	uint32_t checksum;
+};
+
+static_assert( sizeof( WorldChunk ) == 16, "WorldChunk must stay 16 bytes" );
+
+//Hashes the tile layers for the header checksum
+inline uint32_t mapChecksum( const uint8_t* data, size_t size )
+{
+	uint32_t hash = 2166136261u;
+	for( size_t i = 0; i < size; ++i )
+	{
+		hash ^= data[ i ];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+#endif
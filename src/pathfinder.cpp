@@ -0,0 +1,831 @@
+#include "pathfinder.h"
+#include "trace.h"
+#include <stdlib.h>
+#include <algorithm>
+
+//Cost of the straight and diagonal steps between two tiles on a line, and the estimate for any two tiles
+static Uint32 getStepCost( int fromCol, int fromRow, int toCol, int toRow )
+{
+	int dx = abs( toCol - fromCol );
+	int dy = abs( toRow - fromRow );
+	return (Uint32)( PATH_STRAIGHT_COST * SDL_max( dx, dy ) + ( PATH_DIAGONAL_COST - PATH_STRAIGHT_COST ) * SDL_min( dx, dy ) );
+}
+
+PathFinder::PathFinder()
+{
+	//Initialize
+	mLevel = NULL;
+	mColumns = 0;
+	mRows = 0;
+	mVersion = 0;
+	mRegionShift = SOLID_REGION_SHIFT;
+	mRegionColumns = 0;
+	mRegionRows = 0;
+	mUpdates = 0;
+	mSearch.mark = 0;
+	for( int i = 0; i < MAX_FLOW_FIELDS; ++i )
+	{
+		mFields[ i ].goal = -1;
+		mFields[ i ].lastUsed = 0;
+		mFields[ i ].columns = 0;
+		mFields[ i ].stale = false;
+		mFields[ i ].wanted = false;
+		mFields[ i ].building = false;
+	}
+	for( int i = 0; i < MAX_PATH_TASKS; ++i )
+	{
+		mTasks[ i ].finder = this;
+		mTasks[ i ].search.mark = 0;
+		SDL_AtomicSet( &mTasks[ i ].running, 0 );
+		mTasks[ i ].active = false;
+		mTasks[ i ].field = -1;
+		mTasks[ i ].goal = -1;
+	}
+}
+
+PathFinder::~PathFinder()
+{
+	//Deallocate
+	free();
+}
+
+void PathFinder::init( Level* level )
+{
+	free();
+
+	mLevel = level;
+	mColumns = level->getColumns();
+	mRows = level->getRows();
+
+	//Start from the level's tiles as they are now
+	mVersion = level->getSolidVersion();
+	mRegionShift = level->getRegionShift();
+	mRegionColumns = level->getRegionColumns();
+	mRegionRows = level->getRegionRows();
+	mRegionVersions.resize( (size_t)mRegionColumns * mRegionRows );
+	for( size_t i = 0; i < mRegionVersions.size(); ++i )
+	{
+		mRegionVersions[ i ] = level->getRegionVersion( (int)i );
+	}
+	mChanged.assign( mRegionVersions.size(), 0 );
+	mCosts.resize( (size_t)mColumns * mRows );
+	if( !mCosts.empty() )
+	{
+		copyCosts( 0, 0, mColumns - 1, mRows - 1 );
+	}
+}
+
+void PathFinder::free()
+{
+	//The workers have to be done with the tasks before anything goes
+	while( isBusy() )
+	{
+		collect();
+		if( isBusy() )
+		{
+			SDL_Delay( 1 );
+		}
+	}
+
+	mLevel = NULL;
+	mColumns = 0;
+	mRows = 0;
+	mRegionColumns = 0;
+	mRegionRows = 0;
+
+	std::vector<Uint8>().swap( mCosts );
+	mRegionVersions.clear();
+	mChanged.clear();
+	mQueries.clear();
+	mFreeIds.clear();
+	mPending.clear();
+	mCache.clear();
+
+	for( int i = 0; i < MAX_FLOW_FIELDS; ++i )
+	{
+		FlowField& field = mFields[ i ];
+		field.goal = -1;
+		field.lastUsed = 0;
+		field.stale = false;
+		field.wanted = false;
+		std::vector<Uint8>().swap( field.directions );
+		std::vector<Uint8>().swap( field.reached );
+	}
+
+	//Scratch space goes too, it's sized for the level
+	Search* searches[ MAX_PATH_TASKS + 1 ];
+	searches[ 0 ] = &mSearch;
+	for( int i = 0; i < MAX_PATH_TASKS; ++i )
+	{
+		PathTask& task = mTasks[ i ];
+		std::vector<Uint8>().swap( task.directions );
+		std::vector<Uint8>().swap( task.reached );
+		task.queries.clear();
+		searches[ i + 1 ] = &task.search;
+	}
+	for( int i = 0; i < MAX_PATH_TASKS + 1; ++i )
+	{
+		Search& search = *searches[ i ];
+		std::vector<Uint32>().swap( search.marks );
+		std::vector<Uint32>().swap( search.costs );
+		std::vector<int>().swap( search.parents );
+		std::vector<OpenNode>().swap( search.open );
+		search.mark = 0;
+	}
+}
+
+bool PathFinder::findPath( int start, int goal, std::vector<int>& path )
+{
+	checkChanges();
+
+	//Same query as before
+	std::unordered_map<Uint64, CachedPath>::iterator cached = mCache.find( (Uint64)(Uint32)start << 32 | (Uint32)goal );
+	if( cached != mCache.end() )
+	{
+		path = cached->second.path;
+		return true;
+	}
+
+	if( !search( mSearch, start, goal, path ) )
+	{
+		return false;
+	}
+
+	cachePath( start, goal, path );
+	return true;
+}
+
+PathId PathFinder::request( int start, int goal )
+{
+	checkChanges();
+
+	//Reuse a handle if one is free
+	PathId id;
+	if( !mFreeIds.empty() )
+	{
+		id = mFreeIds.back();
+		mFreeIds.pop_back();
+	}
+	else
+	{
+		id = (PathId)mQueries.size();
+		mQueries.push_back( PathQuery() );
+		mQueries.back().serial = 0;
+	}
+
+	PathQuery& query = mQueries[ id ];
+	query.start = start;
+	query.goal = goal;
+	query.serial++;
+	query.path.clear();
+
+	//Answer repeat queries from the cache
+	std::unordered_map<Uint64, CachedPath>::iterator cached = mCache.find( (Uint64)(Uint32)start << 32 | (Uint32)goal );
+	if( cached != mCache.end() )
+	{
+		query.path = cached->second.path;
+		query.state = PATH_FOUND;
+		return id;
+	}
+
+	query.state = PATH_QUEUED;
+	mPending.push_back( id );
+	return id;
+}
+
+bool PathFinder::getPath( PathId id, std::vector<int>& path )
+{
+	if( mQueries[ id ].state != PATH_FOUND )
+	{
+		return false;
+	}
+
+	path = mQueries[ id ].path;
+	return true;
+}
+
+void PathFinder::release( PathId id )
+{
+	//Take it out of the queue if it's still waiting, a task answering it already leaves the answer be
+	if( mQueries[ id ].state == PATH_QUEUED )
+	{
+		std::deque<PathId>::iterator queued = std::find( mPending.begin(), mPending.end(), id );
+		if( queued != mPending.end() )
+		{
+			mPending.erase( queued );
+		}
+	}
+
+	mQueries[ id ].state = PATH_FAILED;
+	mQueries[ id ].serial++;
+	mFreeIds.push_back( id );
+}
+
+void PathFinder::update( JobSystem& jobs, int maxQueries )
+{
+	TRACE_SCOPE( "PathFinder::update" );
+
+	mUpdates++;
+	collect();
+	checkChanges();
+
+	//New work waits for the running tasks while changes are held back, so it runs on the new tiles
+	if( mLevel == NULL || mLevel->getSolidVersion() != mVersion )
+	{
+		return;
+	}
+
+	//A task per worker, each taking a field asked for or a share of the queries
+	int tasks = SDL_max( 1, SDL_min( jobs.getThreadCount() - 1, MAX_PATH_TASKS ) );
+	int share = ( maxQueries + tasks - 1 ) / tasks;
+	for( int i = 0; i < tasks; ++i )
+	{
+		PathTask& task = mTasks[ i ];
+		if( task.active )
+		{
+			continue;
+		}
+
+		task.field = -1;
+		for( int j = 0; j < MAX_FLOW_FIELDS && task.field < 0; ++j )
+		{
+			if( mFields[ j ].wanted && !mFields[ j ].building )
+			{
+				task.field = j;
+			}
+		}
+		if( task.field >= 0 )
+		{
+			task.goal = mFields[ task.field ].goal;
+			mFields[ task.field ].wanted = false;
+			mFields[ task.field ].building = true;
+			launch( task, jobs );
+			continue;
+		}
+
+		//Queries in the order they came
+		task.queries.clear();
+		for( int j = 0; j < share && maxQueries > 0 && !mPending.empty(); ++j )
+		{
+			PathQuery& query = mQueries[ mPending.front() ];
+			TaskQuery work = { mPending.front(), query.serial, query.start, query.goal, false, std::vector<int>() };
+			task.queries.push_back( work );
+			mPending.pop_front();
+			maxQueries--;
+		}
+		if( !task.queries.empty() )
+		{
+			launch( task, jobs );
+		}
+	}
+
+	//Take in what's done already, which is everything when there are no workers
+	collect();
+}
+
+void PathFinder::finish( JobSystem& jobs )
+{
+	while( true )
+	{
+		update( jobs, (int)mPending.size() );
+
+		//Anything asked for that isn't in yet
+		bool waiting = isBusy() || !mPending.empty() || ( mLevel != NULL && mLevel->getSolidVersion() != mVersion );
+		for( int i = 0; i < MAX_FLOW_FIELDS; ++i )
+		{
+			waiting = waiting || mFields[ i ].wanted;
+		}
+		if( !waiting )
+		{
+			break;
+		}
+
+		SDL_Delay( 1 );
+	}
+}
+
+const FlowField* PathFinder::getFlowField( int goal )
+{
+	checkChanges();
+	if( goal < 0 || goal >= mColumns * mRows )
+	{
+		return NULL;
+	}
+
+	//The field for this goal, or else the one used longest ago that isn't being built
+	FlowField* field = NULL;
+	FlowField* oldest = NULL;
+	for( int i = 0; i < MAX_FLOW_FIELDS; ++i )
+	{
+		if( mFields[ i ].goal == goal )
+		{
+			field = &mFields[ i ];
+			break;
+		}
+		if( !mFields[ i ].building && ( oldest == NULL || mFields[ i ].lastUsed < oldest->lastUsed ) )
+		{
+			oldest = &mFields[ i ];
+		}
+	}
+	if( field == NULL )
+	{
+		//Every slot being built, there are more slots than tasks so it never happens
+		if( oldest == NULL )
+		{
+			return NULL;
+		}
+
+		field = oldest;
+		field->goal = goal;
+		field->directions.clear();
+		field->reached.clear();
+		field->stale = true;
+	}
+
+	//Rebuild it in the background, giving out what there is meanwhile
+	field->lastUsed = mUpdates;
+	if( field->stale && !field->building )
+	{
+		field->wanted = true;
+	}
+	return field->directions.empty() ? NULL : field;
+}
+
+bool PathFinder::isBusy()
+{
+	for( int i = 0; i < MAX_PATH_TASKS; ++i )
+	{
+		if( mTasks[ i ].active )
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void PathFinder::taskJob( int first, int last, void* data )
+{
+	TRACE_SCOPE( "PathFinder::task" );
+
+	PathTask* task = (PathTask*)data;
+	PathFinder* self = task->finder;
+	if( task->field >= 0 )
+	{
+		self->buildField( task->search, task->goal, task->directions, task->reached );
+	}
+	else
+	{
+		for( size_t i = 0; i < task->queries.size(); ++i )
+		{
+			TaskQuery& query = task->queries[ i ];
+			query.found = self->search( task->search, query.start, query.goal, query.path );
+		}
+	}
+
+	//Hands it back, nothing touches the task after this
+	SDL_AtomicSet( &task->running, 0 );
+}
+
+void PathFinder::launch( PathTask& task, JobSystem& jobs )
+{
+	task.active = true;
+	SDL_AtomicSet( &task.running, 1 );
+	if( !jobs.addBackground( taskJob, &task, 0, 1 ) )
+	{
+		//No workers, so it's done here and taken in with the rest
+		taskJob( 0, 1, &task );
+	}
+}
+
+void PathFinder::collect()
+{
+	for( int i = 0; i < MAX_PATH_TASKS; ++i )
+	{
+		PathTask& task = mTasks[ i ];
+		if( !task.active || SDL_AtomicGet( &task.running ) != 0 )
+		{
+			continue;
+		}
+		task.active = false;
+
+		//Swap the new field in, the old directions are the next build's memory
+		if( task.field >= 0 )
+		{
+			FlowField& field = mFields[ task.field ];
+			field.directions.swap( task.directions );
+			field.reached.swap( task.reached );
+			field.columns = mColumns;
+			field.stale = false;
+			field.building = false;
+			continue;
+		}
+
+		//Answers to queries that are still wanted
+		for( size_t j = 0; j < task.queries.size(); ++j )
+		{
+			TaskQuery& answer = task.queries[ j ];
+			PathQuery& query = mQueries[ answer.id ];
+			if( query.serial != answer.serial )
+			{
+				continue;
+			}
+
+			query.state = answer.found ? PATH_FOUND : PATH_FAILED;
+			if( answer.found )
+			{
+				query.path.swap( answer.path );
+				cachePath( query.start, query.goal, query.path );
+			}
+		}
+	}
+}
+
+void PathFinder::checkChanges()
+{
+	//Nothing changed, or the tasks are still reading the costs
+	if( mLevel == NULL || mLevel->getSolidVersion() == mVersion || isBusy() )
+	{
+		return;
+	}
+	mVersion = mLevel->getSolidVersion();
+
+	//Copy the costs of the regions that changed
+	std::vector<int> changed;
+	for( int region = 0; region < (int)mRegionVersions.size(); ++region )
+	{
+		mChanged[ region ] = mLevel->getRegionVersion( region ) != mRegionVersions[ region ];
+		if( mChanged[ region ] )
+		{
+			mRegionVersions[ region ] = mLevel->getRegionVersion( region );
+			changed.push_back( region );
+
+			int col = ( region % mRegionColumns ) << mRegionShift;
+			int row = ( region / mRegionColumns ) << mRegionShift;
+			copyCosts( col, row, SDL_min( col + ( 1 << mRegionShift ), mColumns ) - 1, SDL_min( row + ( 1 << mRegionShift ), mRows ) - 1 );
+		}
+	}
+	if( changed.empty() )
+	{
+		return;
+	}
+
+	//Paths crossing a changed region may run into a new wall
+	for( std::unordered_map<Uint64, CachedPath>::iterator cached = mCache.begin(); cached != mCache.end(); )
+	{
+		bool crosses = false;
+		for( size_t i = 0; i < cached->second.regions.size() && !crosses; ++i )
+		{
+			crosses = mChanged[ cached->second.regions[ i ] ] != 0;
+		}
+		if( crosses )
+		{
+			cached = mCache.erase( cached );
+		}
+		else
+		{
+			++cached;
+		}
+	}
+
+	//Fields reaching into a changed region or the ones around it, where a new opening would join up
+	for( int i = 0; i < MAX_FLOW_FIELDS; ++i )
+	{
+		FlowField& field = mFields[ i ];
+		for( size_t j = 0; j < changed.size() && !field.reached.empty() && !field.stale; ++j )
+		{
+			int regionCol = changed[ j ] % mRegionColumns;
+			int regionRow = changed[ j ] / mRegionColumns;
+			for( int row = SDL_max( regionRow - 1, 0 ); row <= SDL_min( regionRow + 1, mRegionRows - 1 ); ++row )
+			{
+				for( int col = SDL_max( regionCol - 1, 0 ); col <= SDL_min( regionCol + 1, mRegionColumns - 1 ); ++col )
+				{
+					field.stale = field.stale || field.reached[ row * mRegionColumns + col ] != 0;
+				}
+			}
+		}
+	}
+}
+
+void PathFinder::copyCosts( int firstCol, int firstRow, int lastCol, int lastRow )
+{
+	for( int row = firstRow; row <= lastRow; ++row )
+	{
+		mLevel->visitRuns( row, firstCol, lastCol, copyRun, this );
+	}
+}
+
+bool PathFinder::copyRun( int row, int firstCol, int lastCol, int type, void* data )
+{
+	//Every tile of a run costs the same to walk unless it's been walled off
+	PathFinder* self = (PathFinder*)data;
+	Uint8 cost = (Uint8)SDL_max( getTileTraits( type ).cost, 1 );
+	for( int col = firstCol; col <= lastCol; ++col )
+	{
+		self->mCosts[ row * self->mColumns + col ] = self->mLevel->isSolid( col, row ) ? 0 : cost;
+	}
+
+	return true;
+}
+
+void PathFinder::cachePath( int start, int goal, const std::vector<int>& path )
+{
+	if( mCache.size() >= (size_t)MAX_CACHED_PATHS )
+	{
+		mCache.clear();
+	}
+	CachedPath& cached = mCache[ (Uint64)(Uint32)start << 32 | (Uint32)goal ];
+	cached.path = path;
+
+	//Every tile stepped on, and the tiles beside diagonal steps that have to stay open
+	cached.regions.clear();
+	for( size_t i = 0; i < path.size(); ++i )
+	{
+		int col = path[ i ] % mColumns;
+		int row = path[ i ] / mColumns;
+		cached.regions.push_back( getRegion( col, row ) );
+		if( i + 1 == path.size() )
+		{
+			break;
+		}
+
+		int nextCol = path[ i + 1 ] % mColumns;
+		int nextRow = path[ i + 1 ] / mColumns;
+		int dx = ( nextCol > col ) - ( nextCol < col );
+		int dy = ( nextRow > row ) - ( nextRow < row );
+		while( col != nextCol || row != nextRow )
+		{
+			if( dx != 0 && dy != 0 )
+			{
+				cached.regions.push_back( getRegion( col + dx, row ) );
+				cached.regions.push_back( getRegion( col, row + dy ) );
+			}
+			col += dx;
+			row += dy;
+
+			//Only where it crosses into another region
+			int region = getRegion( col, row );
+			if( region != cached.regions.back() )
+			{
+				cached.regions.push_back( region );
+			}
+		}
+	}
+	std::sort( cached.regions.begin(), cached.regions.end() );
+	cached.regions.erase( std::unique( cached.regions.begin(), cached.regions.end() ), cached.regions.end() );
+}
+
+void PathFinder::beginSearch( Search& search )
+{
+	size_t tiles = (size_t)mColumns * mRows;
+	if( search.marks.size() != tiles )
+	{
+		search.marks.assign( tiles, 0 );
+		search.costs.resize( tiles );
+		search.parents.resize( tiles );
+		search.mark = 0;
+	}
+
+	//A new mark for the tiles this search reaches, starting over when it wraps
+	if( ++search.mark == 0 )
+	{
+		std::fill( search.marks.begin(), search.marks.end(), 0 );
+		search.mark = 1;
+	}
+	search.open.clear();
+}
+
+bool PathFinder::search( Search& search, int start, int goal, std::vector<int>& path )
+{
+	TRACE_SCOPE( "PathFinder::search" );
+
+	path.clear();
+	int tiles = mColumns * mRows;
+	if( start < 0 || goal < 0 || start >= tiles || goal >= tiles || !isOpen( start % mColumns, start / mColumns ) || !isOpen( goal % mColumns, goal / mColumns ) )
+	{
+		return false;
+	}
+	int goalCol = goal % mColumns;
+	int goalRow = goal / mColumns;
+
+	beginSearch( search );
+	search.marks[ start ] = search.mark;
+	search.costs[ start ] = 0;
+	search.parents[ start ] = -1;
+	OpenNode first = { getStepCost( start % mColumns, start / mColumns, goalCol, goalRow ), 0, start };
+	search.open.push_back( first );
+
+	while( !search.open.empty() )
+	{
+		std::pop_heap( search.open.begin(), search.open.end(), isWorse );
+		OpenNode node = search.open.back();
+		search.open.pop_back();
+
+		//Reached again more cheaply since this was queued
+		if( node.cost != search.costs[ node.tile ] )
+		{
+			continue;
+		}
+
+		//Walk the jump points back to the start
+		if( node.tile == goal )
+		{
+			for( int tile = goal; tile != -1; tile = search.parents[ tile ] )
+			{
+				path.push_back( tile );
+			}
+			std::reverse( path.begin(), path.end() );
+			return true;
+		}
+
+		//Directions worth trying, only those the way in doesn't already cover more cheaply
+		int col = node.tile % mColumns;
+		int row = node.tile / mColumns;
+		int directions[ FLOW_DIRECTIONS ][ 2 ];
+		int count = 0;
+		int parent = search.parents[ node.tile ];
+		if( parent < 0 )
+		{
+			for( int i = 0; i < FLOW_DIRECTIONS; ++i )
+			{
+				if( canStep( col, row, FLOW_STEPS[ i ][ 0 ], FLOW_STEPS[ i ][ 1 ] ) )
+				{
+					directions[ count ][ 0 ] = FLOW_STEPS[ i ][ 0 ];
+					directions[ count++ ][ 1 ] = FLOW_STEPS[ i ][ 1 ];
+				}
+			}
+		}
+		else
+		{
+			int dx = ( col > parent % mColumns ) - ( col < parent % mColumns );
+			int dy = ( row > parent / mColumns ) - ( row < parent / mColumns );
+			if( dx != 0 && dy != 0 )
+			{
+				//On along the diagonal and both its sides
+				int sides[ 3 ][ 2 ] = { { 0, dy }, { dx, 0 }, { dx, dy } };
+				for( int i = 0; i < 3; ++i )
+				{
+					if( canStep( col, row, sides[ i ][ 0 ], sides[ i ][ 1 ] ) )
+					{
+						directions[ count ][ 0 ] = sides[ i ][ 0 ];
+						directions[ count++ ][ 1 ] = sides[ i ][ 1 ];
+					}
+				}
+			}
+			else
+			{
+				//On ahead, and out to the sides where a wall behind them opened a way
+				int sideX = dy, sideY = dx;
+				int turns[ 5 ][ 2 ] = { { dx, dy }, { dx + sideX, dy + sideY }, { dx - sideX, dy - sideY }, { sideX, sideY }, { -sideX, -sideY } };
+				for( int i = 0; i < 5; ++i )
+				{
+					if( canStep( col, row, turns[ i ][ 0 ], turns[ i ][ 1 ] ) )
+					{
+						directions[ count ][ 0 ] = turns[ i ][ 0 ];
+						directions[ count++ ][ 1 ] = turns[ i ][ 1 ];
+					}
+				}
+			}
+		}
+
+		//Jump along each one and queue the points it stops at
+		for( int i = 0; i < count; ++i )
+		{
+			int found = jump( col + directions[ i ][ 0 ], row + directions[ i ][ 1 ], directions[ i ][ 0 ], directions[ i ][ 1 ], goal );
+			if( found < 0 )
+			{
+				continue;
+			}
+
+			int foundCol = found % mColumns;
+			int foundRow = found / mColumns;
+			Uint32 cost = node.cost + getStepCost( col, row, foundCol, foundRow );
+			if( isReached( search, found ) && search.costs[ found ] <= cost )
+			{
+				continue;
+			}
+
+			search.marks[ found ] = search.mark;
+			search.costs[ found ] = cost;
+			search.parents[ found ] = node.tile;
+			OpenNode next = { cost + getStepCost( foundCol, foundRow, goalCol, goalRow ), cost, found };
+			search.open.push_back( next );
+			std::push_heap( search.open.begin(), search.open.end(), isWorse );
+		}
+	}
+
+	return false;
+}
+
+int PathFinder::jump( int col, int row, int dx, int dy, int goal )
+{
+	while( true )
+	{
+		if( !isOpen( col, row ) )
+		{
+			return -1;
+		}
+
+		int tile = row * mColumns + col;
+		if( tile == goal )
+		{
+			return tile;
+		}
+
+		if( dx != 0 && dy != 0 )
+		{
+			//A diagonal stops where a straight line from it leads somewhere
+			if( jump( col + dx, row, dx, 0, goal ) >= 0 || jump( col, row + dy, 0, dy, goal ) >= 0 )
+			{
+				return tile;
+			}
+
+			//And can't squeeze between two walls
+			if( !isOpen( col + dx, row ) || !isOpen( col, row + dy ) )
+			{
+				return -1;
+			}
+		}
+		else if( dx != 0 )
+		{
+			//A straight line stops beside the end of a wall, where a way opens to the side
+			if( ( isOpen( col, row - 1 ) && !isOpen( col - dx, row - 1 ) ) || ( isOpen( col, row + 1 ) && !isOpen( col - dx, row + 1 ) ) )
+			{
+				return tile;
+			}
+		}
+		else
+		{
+			if( ( isOpen( col - 1, row ) && !isOpen( col - 1, row - dy ) ) || ( isOpen( col + 1, row ) && !isOpen( col + 1, row - dy ) ) )
+			{
+				return tile;
+			}
+		}
+
+		col += dx;
+		row += dy;
+	}
+}
+
+void PathFinder::buildField( Search& search, int goal, std::vector<Uint8>& directions, std::vector<Uint8>& reached )
+{
+	TRACE_SCOPE( "PathFinder::buildField" );
+
+	int tiles = mColumns * mRows;
+	directions.assign( tiles, FLOW_NONE );
+	reached.assign( (size_t)mRegionColumns * mRegionRows, 0 );
+	if( goal < 0 || goal >= tiles || !isOpen( goal % mColumns, goal / mColumns ) )
+	{
+		return;
+	}
+
+	//Spread out from the goal, cheapest first, each tile pointing at the one it was reached from
+	beginSearch( search );
+	search.marks[ goal ] = search.mark;
+	search.costs[ goal ] = 0;
+	OpenNode first = { 0, 0, goal };
+	search.open.push_back( first );
+
+	while( !search.open.empty() )
+	{
+		std::pop_heap( search.open.begin(), search.open.end(), isWorse );
+		OpenNode node = search.open.back();
+		search.open.pop_back();
+		if( node.cost != search.costs[ node.tile ] )
+		{
+			continue;
+		}
+
+		//Walking onto this tile costs what its type says
+		int col = node.tile % mColumns;
+		int row = node.tile / mColumns;
+		Uint32 enter = mCosts[ node.tile ];
+		reached[ getRegion( col, row ) ] = 1;
+		for( int i = 0; i < FLOW_DIRECTIONS; ++i )
+		{
+			//The neighbour that would step here going this way
+			int dx = FLOW_STEPS[ i ][ 0 ];
+			int dy = FLOW_STEPS[ i ][ 1 ];
+			int fromCol = col - dx;
+			int fromRow = row - dy;
+			if( !isOpen( fromCol, fromRow ) || !canStep( fromCol, fromRow, dx, dy ) )
+			{
+				continue;
+			}
+
+			int from = fromRow * mColumns + fromCol;
+			Uint32 cost = node.cost + enter * ( dx != 0 && dy != 0 ? PATH_DIAGONAL_COST : PATH_STRAIGHT_COST );
+			if( isReached( search, from ) && search.costs[ from ] <= cost )
+			{
+				continue;
+			}
+
+			search.marks[ from ] = search.mark;
+			search.costs[ from ] = cost;
+			directions[ from ] = (Uint8)i;
+			OpenNode next = { cost, cost, from };
+			search.open.push_back( next );
+			std::push_heap( search.open.begin(), search.open.end(), isWorse );
+		}
+	}
+}
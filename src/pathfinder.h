@@ -0,0 +1,270 @@
+#ifndef PATHFINDER_H
+#define PATHFINDER_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include "level.h"
+#include "jobsystem.h"
+
+//Most flow fields kept, the one used longest ago makes room for a new goal
+const int MAX_FLOW_FIELDS = 8;
+
+//Most paths kept for repeat queries, the cache starts over when it fills
+const int MAX_CACHED_PATHS = 1024;
+
+//Most searches running in the background at once, each keeps a dozen bytes per tile
+const int MAX_PATH_TASKS = 4;
+
+//Cost of a straight and a diagonal step, in tenths of a tile
+const int PATH_STRAIGHT_COST = 10;
+const int PATH_DIAGONAL_COST = 14;
+
+//Flow directions as steps across the grid, straight ones first
+const int FLOW_DIRECTIONS = 8;
+const int FLOW_STEPS[ FLOW_DIRECTIONS ][ 2 ] = { { 0, -1 }, { 1, 0 }, { 0, 1 }, { -1, 0 }, { 1, -1 }, { 1, 1 }, { -1, 1 }, { -1, -1 } };
+
+//Flow direction at the goal and wherever it can't be reached from
+const Uint8 FLOW_NONE = FLOW_DIRECTIONS;
+
+//Handle to a queued path query
+typedef int PathId;
+
+//Where a path query is at
+enum PathState
+{
+	PATH_QUEUED,
+	PATH_FOUND,
+	PATH_FAILED
+};
+
+//Which way to step from each tile to get to one goal tile by the cheapest walk
+struct FlowField
+{
+	//Goal tile index, -1 for an unused field
+	int goal;
+
+	//Update it was last asked for in, for picking one to replace
+	Uint32 lastUsed;
+
+	//Flow direction by tile index, empty until it's first built, and tiles across the level
+	std::vector<Uint8> directions;
+	int columns;
+
+	//Whether each region of the level has a tile the goal can be reached from, changes anywhere else leave the field be
+	std::vector<Uint8> reached;
+
+	//Whether the tiles changed under it, it's been asked for since, and a rebuild is running
+	bool stale;
+	bool wanted;
+	bool building;
+};
+
+//Routes over the tiles of a level
+//One off queries use jump point search, which skips along straight runs of open tiles and only stops
+//where a wall opens up a new way to go, so open ground costs next to nothing
+//Many agents going the same way share a flow field built once toward their goal and then just look up their tile
+//Searches run on a copy of the walking costs, so queued queries and new or stale fields go to the job workers
+//in the background across frames while the level streams, and a stale field is given out until its rebuild is in
+//Tile changes are taken in a region at a time, dropping only the paths and fields that cross the changed regions
+class PathFinder
+{
+	public:
+		//Initializes variables
+		PathFinder();
+
+		//Waits for background searches
+		~PathFinder();
+
+		//Routes over a level, dropping anything cached for the last one
+		//Copies a walking cost byte per tile, the scratch space for searches is only sized when one first runs
+		void init( Level* level );
+
+		//Waits for background searches and deallocates searches, fields and cached paths
+		void free();
+
+		//Finds a path from start to goal tile on the calling thread, false if there is none
+		//Path gets the tiles it turns at, start and goal included, the tiles between are in straight or diagonal lines
+		bool findPath( int start, int goal, std::vector<int>& path );
+
+		//Queues a path query for the background, answering it right away if it's cached
+		PathId request( int start, int goal );
+
+		//Gets where a query is at
+		PathState getState( PathId id ) { return mQueries[ id ].state; }
+
+		//Gets a found path, false unless the query has been answered with one
+		bool getPath( PathId id, std::vector<int>& path );
+
+		//Forgets a query, its handle can be given out again
+		void release( PathId id );
+
+		//Takes in finished searches and tile changes, then hands up to maxQueries queued queries and the fields
+		//asked for to the job workers without waiting on them
+		void update( JobSystem& jobs, int maxQueries );
+
+		//Updates until every queued query is answered and every field asked for is built
+		void finish( JobSystem& jobs );
+
+		//Gets the flow field toward a goal tile, NULL until it's first built, which the next update starts
+		//A field the tiles changed under is still given out while its rebuild runs,
+		//it stays valid until the next update or until a field for another goal takes its place
+		const FlowField* getFlowField( int goal );
+
+		//Gets the queued queries and cached paths
+		int getQueuedCount() { return (int)mPending.size(); }
+		int getCachedCount() { return (int)mCache.size(); }
+
+		//Whether any search is out with the workers or waiting to be taken in
+		bool isBusy();
+
+	private:
+		//A node on the open list
+		struct OpenNode
+		{
+			Uint32 score;
+			Uint32 cost;
+			int tile;
+		};
+
+		//Scratch space for one search at a time, marked per search so it's never cleared
+		struct Search
+		{
+			std::vector<Uint32> marks;
+			std::vector<Uint32> costs;
+			std::vector<int> parents;
+			std::vector<OpenNode> open;
+			Uint32 mark;
+		};
+
+		//A queued or answered query, the serial changes whenever its handle is released or given out
+		struct PathQuery
+		{
+			int start;
+			int goal;
+			PathState state;
+			Uint32 serial;
+			std::vector<int> path;
+		};
+
+		//A query handed to a background search
+		struct TaskQuery
+		{
+			PathId id;
+			Uint32 serial;
+			int start;
+			int goal;
+			bool found;
+			std::vector<int> path;
+		};
+
+		//A found path and the regions its steps cross
+		struct CachedPath
+		{
+			std::vector<int> path;
+			std::vector<int> regions;
+		};
+
+		//Work handed to the workers, a field to build or queries to answer, with its own scratch space
+		struct PathTask
+		{
+			PathFinder* finder;
+			Search search;
+
+			//Set while a worker has it, and from when it's handed out until it's taken back
+			SDL_atomic_t running;
+			bool active;
+
+			//Field slot to build, -1 for queries, its goal and what's built for it
+			int field;
+			int goal;
+			std::vector<Uint8> directions;
+			std::vector<Uint8> reached;
+
+			//Queries to answer
+			std::vector<TaskQuery> queries;
+		};
+
+		//Open list order, cheapest estimate first
+		static bool isWorse( const OpenNode& a, const OpenNode& b ) { return a.score > b.score; }
+
+		//Job body for a task, runs on a worker
+		static void taskJob( int first, int last, void* data );
+
+		//Hands a task to the workers, or runs it here if there are none
+		void launch( PathTask& task, JobSystem& jobs );
+
+		//Takes in what the finished tasks found
+		void collect();
+
+		//Takes in the regions whose tiles changed once no task is reading the costs
+		void checkChanges();
+
+		//Copies the walking costs of a range of tiles from the level
+		void copyCosts( int firstCol, int firstRow, int lastCol, int lastRow );
+
+		//Run visitor for copyCosts, data is the path finder
+		static bool copyRun( int row, int firstCol, int lastCol, int type, void* data );
+
+		//Keeps a found path for repeat queries, with the regions it crosses
+		void cachePath( int start, int goal, const std::vector<int>& path );
+
+		//Gets the region a tile is in
+		int getRegion( int col, int row ) { return ( row >> mRegionShift ) * mRegionColumns + ( col >> mRegionShift ); }
+
+		//Starts a search, sizing its scratch space for the level
+		void beginSearch( Search& search );
+
+		//Whether a search has reached a tile yet
+		bool isReached( Search& search, int tile ) { return search.marks[ tile ] == search.mark; }
+
+		//Whether a tile is inside the level and can be walked
+		bool isOpen( int col, int row ) { return col >= 0 && row >= 0 && col < mColumns && row < mRows && mCosts[ row * mColumns + col ] != 0; }
+
+		//Whether a step from a tile can be taken, diagonals need both tiles beside them open so boxes don't clip corners
+		bool canStep( int col, int row, int dx, int dy ) { return isOpen( col + dx, row + dy ) && ( dx == 0 || dy == 0 || ( isOpen( col + dx, row ) && isOpen( col, row + dy ) ) ); }
+
+		//Finds a path with a search's scratch space
+		bool search( Search& search, int start, int goal, std::vector<int>& path );
+
+		//Follows a direction from a tile until a jump point, the goal, or a wall, -1 for a wall
+		int jump( int col, int row, int dx, int dy, int goal );
+
+		//Builds the flow directions toward a goal and the regions it reaches with a search's scratch space
+		void buildField( Search& search, int goal, std::vector<Uint8>& directions, std::vector<Uint8>& reached );
+
+		//The level routed over
+		Level* mLevel;
+		int mColumns;
+		int mRows;
+
+		//Walking cost of each tile, 0 for solid ones, only changed while no task is running
+		std::vector<Uint8> mCosts;
+
+		//Level solid version and region versions the costs match, regions taken in at the last change
+		Uint32 mVersion;
+		std::vector<Uint32> mRegionVersions;
+		std::vector<Uint8> mChanged;
+		int mRegionShift;
+		int mRegionColumns;
+		int mRegionRows;
+
+		//Queries by handle, free handles, and ones waiting for a task
+		std::vector<PathQuery> mQueries;
+		std::vector<PathId> mFreeIds;
+		std::deque<PathId> mPending;
+
+		//Paths found by start and goal tile
+		std::unordered_map<Uint64, CachedPath> mCache;
+
+		//Flow fields by slot
+		FlowField mFields[ MAX_FLOW_FIELDS ];
+		Uint32 mUpdates;
+
+		//Scratch space for searches on the calling thread, and the background tasks
+		Search mSearch;
+		PathTask mTasks[ MAX_PATH_TASKS ];
+};
+
+#endif
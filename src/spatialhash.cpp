@@ -0,0 +1,175 @@
+#include "spatialhash.h"
+#include <algorithm>
+
+SpatialHash::SpatialHash( int cellShift )
+{
+	//Initialize
+	mCellShift = cellShift;
+	mBucketStarts.assign( 2, 0 );
+	mBucketMask = 0;
+	mQuery = 0;
+}
+
+void SpatialHash::build( BoxBatch& boxes )
+{
+	int count = boxes.getCount();
+	const Sint32* x = boxes.getX();
+	const Sint32* y = boxes.getY();
+	const Sint32* w = boxes.getW();
+	const Sint32* h = boxes.getH();
+
+	//Count the cells each box covers, edges are exclusive like checkCollision
+	size_t entries = 0;
+	for( int i = 0; i < count; ++i )
+	{
+		if( w[ i ] > 0 && h[ i ] > 0 )
+		{
+			entries += (size_t)( ( ( x[ i ] + w[ i ] - 1 ) >> mCellShift ) - ( x[ i ] >> mCellShift ) + 1 ) * ( ( ( y[ i ] + h[ i ] - 1 ) >> mCellShift ) - ( y[ i ] >> mCellShift ) + 1 );
+		}
+	}
+
+	//A bucket or two per entry, more only spreads the table over more cache lines
+	Uint32 buckets = 16;
+	while( buckets < entries )
+	{
+		buckets *= 2;
+	}
+	mBucketMask = buckets - 1;
+	mBucketStarts.assign( buckets + 1, 0 );
+	mEntries.resize( entries );
+
+	//Count the entries per bucket, turn the counts into where each bucket ends,
+	//then fill each bucket from its end so the ends come down to the starts
+	for( int pass = 0; pass < 2; ++pass )
+	{
+		for( int i = 0; i < count; ++i )
+		{
+			if( w[ i ] <= 0 || h[ i ] <= 0 )
+			{
+				continue;
+			}
+
+			int lastX = ( x[ i ] + w[ i ] - 1 ) >> mCellShift;
+			int lastY = ( y[ i ] + h[ i ] - 1 ) >> mCellShift;
+			for( int cellY = y[ i ] >> mCellShift; cellY <= lastY; ++cellY )
+			{
+				for( int cellX = x[ i ] >> mCellShift; cellX <= lastX; ++cellX )
+				{
+					Uint32 bucket = getBucket( cellX, cellY );
+					if( pass == 0 )
+					{
+						mBucketStarts[ bucket ]++;
+					}
+					else
+					{
+						Entry entry = { cellX, cellY, i };
+						mEntries[ --mBucketStarts[ bucket ] ] = entry;
+					}
+				}
+			}
+		}
+
+		if( pass == 0 )
+		{
+			for( Uint32 bucket = 1; bucket <= buckets; ++bucket )
+			{
+				mBucketStarts[ bucket ] += mBucketStarts[ bucket - 1 ];
+			}
+		}
+	}
+}
+
+int SpatialHash::findPairs( BoxBatch& boxes, std::vector<BoxPair>& pairs )
+{
+	return findPairs( boxes, pairs, 0, mBucketMask + 1 );
+}
+
+int SpatialHash::findPairs( BoxBatch& boxes, std::vector<BoxPair>& pairs, Uint32 firstBucket, Uint32 lastBucket )
+{
+	pairs.clear();
+	const Sint32* x = boxes.getX();
+	const Sint32* y = boxes.getY();
+
+	lastBucket = SDL_min( lastBucket, mBucketMask + 1 );
+	for( Uint32 bucket = firstBucket; bucket < lastBucket; ++bucket )
+	{
+		Uint32 end = mBucketStarts[ bucket + 1 ];
+		for( Uint32 first = mBucketStarts[ bucket ]; first < end; ++first )
+		{
+			const Entry& a = mEntries[ first ];
+			for( Uint32 second = first + 1; second < end; ++second )
+			{
+				//Other cells can hash to the same bucket
+				const Entry& b = mEntries[ second ];
+				if( a.cellX != b.cellX || a.cellY != b.cellY )
+				{
+					continue;
+				}
+
+				//Boxes sharing several cells pair up only in the cell holding the top left of their overlap
+				int left = SDL_max( x[ a.box ], x[ b.box ] );
+				int top = SDL_max( y[ a.box ], y[ b.box ] );
+				if( ( left >> mCellShift ) == a.cellX && ( top >> mCellShift ) == a.cellY )
+				{
+					BoxPair pair = { SDL_min( a.box, b.box ), SDL_max( a.box, b.box ) };
+					pairs.push_back( pair );
+				}
+			}
+		}
+	}
+
+	return (int)pairs.size();
+}
+
+int SpatialHash::query( BoxBatch& boxes, const SDL_Rect& area, std::vector<int>& hits )
+{
+	hits.clear();
+	if( area.w <= 0 || area.h <= 0 )
+	{
+		return 0;
+	}
+
+	const Sint32* x = boxes.getX();
+	const Sint32* y = boxes.getY();
+	const Sint32* w = boxes.getW();
+	const Sint32* h = boxes.getH();
+
+	//A new mark for boxes seen by this query, starting over when it wraps
+	if( mSeen.size() < (size_t)boxes.getCount() )
+	{
+		mSeen.resize( boxes.getCount(), 0 );
+	}
+	if( ++mQuery == 0 )
+	{
+		std::fill( mSeen.begin(), mSeen.end(), 0 );
+		mQuery = 1;
+	}
+
+	int lastX = ( area.x + area.w - 1 ) >> mCellShift;
+	int lastY = ( area.y + area.h - 1 ) >> mCellShift;
+	for( int cellY = area.y >> mCellShift; cellY <= lastY; ++cellY )
+	{
+		for( int cellX = area.x >> mCellShift; cellX <= lastX; ++cellX )
+		{
+			Uint32 bucket = getBucket( cellX, cellY );
+			for( Uint32 i = mBucketStarts[ bucket ]; i < mBucketStarts[ bucket + 1 ]; ++i )
+			{
+				const Entry& entry = mEntries[ i ];
+				int box = entry.box;
+				if( entry.cellX != cellX || entry.cellY != cellY || mSeen[ box ] == mQuery )
+				{
+					continue;
+				}
+				mSeen[ box ] = mQuery;
+
+				//Same overlap test as checkCollision
+				if( x[ box ] < area.x + area.w && x[ box ] + w[ box ] > area.x && y[ box ] < area.y + area.h && y[ box ] + h[ box ] > area.y )
+				{
+					hits.push_back( box );
+				}
+			}
+		}
+	}
+
+	return (int)hits.size();
+}
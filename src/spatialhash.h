@@ -0,0 +1,69 @@
+#ifndef SPATIALHASH_H
+#define SPATIALHASH_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+#include "boxbatch.h"
+
+//Default grid cell side as a power of two, 128 pixels holds a player sized box in one to four cells
+const int DEFAULT_CELL_SHIFT = 7;
+
+//Two boxes by index that may overlap
+struct BoxPair
+{
+	int a;
+	int b;
+};
+
+//Uniform grid over a batch of boxes, hashed so it covers any world size
+//Rebuilt from scratch each tick with a counting sort, which costs about as much as updating it in place
+//and leaves each bucket's boxes next to each other
+class SpatialHash
+{
+	public:
+		//Initializes an empty grid with cells 1 << cellShift pixels across
+		SpatialHash( int cellShift = DEFAULT_CELL_SHIFT );
+
+		//Files every box under the cells it covers, empty boxes are left out
+		void build( BoxBatch& boxes );
+
+		//Lists each pair of boxes that share a cell once, the candidates for a narrow phase
+		//Returns the pairs found
+		int findPairs( BoxBatch& boxes, std::vector<BoxPair>& pairs );
+
+		//Lists the pairs from buckets first to last - 1 only, so threads can split the buckets between them
+		int findPairs( BoxBatch& boxes, std::vector<BoxPair>& pairs, Uint32 firstBucket, Uint32 lastBucket );
+
+		//Lists the boxes overlapping an area, returns the boxes found
+		int query( BoxBatch& boxes, const SDL_Rect& area, std::vector<int>& hits );
+
+		//Gets the cell entries and buckets of the last build
+		int getEntryCount() { return (int)mEntries.size(); }
+		int getBucketCount() { return (int)mBucketStarts.size() - 1; }
+
+	private:
+		//A box filed under a cell
+		struct Entry
+		{
+			Sint32 cellX;
+			Sint32 cellY;
+			int box;
+		};
+
+		//Gets the bucket of a cell
+		Uint32 getBucket( Sint32 cellX, Sint32 cellY ) { return ( (Uint32)cellX * 73856093u ^ (Uint32)cellY * 19349663u ) & mBucketMask; }
+
+		//Cell size
+		int mCellShift;
+
+		//Entries by bucket, with the first entry of each bucket and one past the last bucket at the end
+		std::vector<Entry> mEntries;
+		std::vector<Uint32> mBucketStarts;
+		Uint32 mBucketMask;
+
+		//Query to box last seen in, so boxes in several cells are listed once
+		std::vector<Uint32> mSeen;
+		Uint32 mQuery;
+};
+
+#endif
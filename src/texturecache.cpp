@@ -0,0 +1,266 @@
+#include "texturecache.h"
+#include <SDL2/SDL_image.h>
+#include <stdio.h>
+
+TextureRef::TextureRef()
+{
+	mCache = NULL;
+	mEntry = -1;
+}
+
+TextureRef::TextureRef( TextureCache* cache, int entry )
+{
+	mCache = cache;
+	mEntry = entry;
+	mCache->mEntries[ mEntry ].refs++;
+}
+
+TextureRef::TextureRef( const TextureRef& other )
+{
+	mCache = other.mCache;
+	mEntry = other.mEntry;
+	if( mCache != NULL )
+	{
+		mCache->mEntries[ mEntry ].refs++;
+	}
+}
+
+TextureRef& TextureRef::operator=( const TextureRef& other )
+{
+	if( this != &other )
+	{
+		//Take the new reference before dropping the old one, they may be the same entry
+		if( other.mCache != NULL )
+		{
+			other.mCache->mEntries[ other.mEntry ].refs++;
+		}
+		release();
+		mCache = other.mCache;
+		mEntry = other.mEntry;
+	}
+
+	return *this;
+}
+
+TextureRef::~TextureRef()
+{
+	release();
+}
+
+void TextureRef::release()
+{
+	if( mCache != NULL )
+	{
+		TextureCache* cache = mCache;
+		cache->mEntries[ mEntry ].refs--;
+		mCache = NULL;
+		mEntry = -1;
+
+		//The texture may now be droppable
+		if( cache->mBytes > cache->mBudget )
+		{
+			cache->trim();
+		}
+	}
+}
+
+SDL_Texture* TextureRef::get()
+{
+	if( mCache == NULL )
+	{
+		return NULL;
+	}
+
+	TextureCache::Entry& entry = mCache->mEntries[ mEntry ];
+	entry.lastUsed = ++mCache->mClock;
+	return entry.texture;
+}
+
+int TextureRef::getWidth()
+{
+	return mCache != NULL ? mCache->mEntries[ mEntry ].width : 0;
+}
+
+int TextureRef::getHeight()
+{
+	return mCache != NULL ? mCache->mEntries[ mEntry ].height : 0;
+}
+
+TextureCache::TextureCache()
+{
+	//Initialize
+	mRenderer = NULL;
+	mKeyRed = mKeyGreen = mKeyBlue = 0;
+	mClock = 0;
+	mBytes = 0;
+	mBudget = (size_t)-1;
+	mHits = 0;
+	mMisses = 0;
+	mEvictions = 0;
+}
+
+TextureCache::~TextureCache()
+{
+	clear();
+}
+
+void TextureCache::setRenderer( SDL_Renderer* renderer )
+{
+	mRenderer = renderer;
+}
+
+void TextureCache::setColorKey( Uint8 red, Uint8 green, Uint8 blue )
+{
+	mKeyRed = red;
+	mKeyGreen = green;
+	mKeyBlue = blue;
+}
+
+void TextureCache::setBudget( size_t bytes )
+{
+	mBudget = bytes;
+	trim();
+}
+
+TextureRef TextureCache::load( std::string path )
+{
+	TextureRef cached = find( path );
+	if( cached.isValid() )
+	{
+		return cached;
+	}
+
+	//Load image at specified path
+	SDL_Surface* loadedSurface = IMG_Load( path.c_str() );
+	if( loadedSurface == NULL )
+	{
+		printf( "Unable to load image %s! SDL_image Error: %s\n", path.c_str(), IMG_GetError() );
+		return TextureRef();
+	}
+
+	TextureRef loaded = insert( path, loadedSurface );
+	SDL_FreeSurface( loadedSurface );
+
+	return loaded;
+}
+
+TextureRef TextureCache::find( std::string path )
+{
+	std::unordered_map<std::string, int>::iterator found = mPaths.find( path );
+	if( found == mPaths.end() )
+	{
+		return TextureRef();
+	}
+
+	mHits++;
+	mEntries[ found->second ].lastUsed = ++mClock;
+	return TextureRef( this, found->second );
+}
+
+TextureRef TextureCache::insert( std::string path, SDL_Surface* surface )
+{
+	//Someone else uploaded it first
+	std::unordered_map<std::string, int>::iterator found = mPaths.find( path );
+	if( found != mPaths.end() )
+	{
+		mHits++;
+		mEntries[ found->second ].lastUsed = ++mClock;
+		return TextureRef( this, found->second );
+	}
+
+	//Color key image
+	SDL_SetColorKey( surface, SDL_TRUE, SDL_MapRGB( surface->format, mKeyRed, mKeyGreen, mKeyBlue ) );
+
+	//Create texture from surface pixels
+	SDL_Texture* texture = SDL_CreateTextureFromSurface( mRenderer, surface );
+	if( texture == NULL )
+	{
+		printf( "Unable to create texture from %s! SDL Error: %s\n", path.c_str(), SDL_GetError() );
+		return TextureRef();
+	}
+	mMisses++;
+
+	//Fill a free slot, or add one
+	Entry entry;
+	entry.path = path;
+	entry.texture = texture;
+	entry.width = surface->w;
+	entry.height = surface->h;
+	entry.bytes = (size_t)surface->w * surface->h * 4;
+	entry.refs = 0;
+	entry.lastUsed = ++mClock;
+
+	int index;
+	if( !mFreeSlots.empty() )
+	{
+		index = mFreeSlots.back();
+		mFreeSlots.pop_back();
+		mEntries[ index ] = entry;
+	}
+	else
+	{
+		index = (int)mEntries.size();
+		mEntries.push_back( entry );
+	}
+	mPaths[ path ] = index;
+	mBytes += entry.bytes;
+
+	//Hold it before trimming so the new texture survives
+	TextureRef inserted( this, index );
+	trim();
+
+	return inserted;
+}
+
+void TextureCache::trim()
+{
+	while( mBytes > mBudget )
+	{
+		//Find the least recently used texture nobody holds
+		int oldest = -1;
+		for( size_t i = 0; i < mEntries.size(); ++i )
+		{
+			Entry& entry = mEntries[ i ];
+			if( entry.texture != NULL && entry.refs == 0 && ( oldest < 0 || entry.lastUsed < mEntries[ oldest ].lastUsed ) )
+			{
+				oldest = (int)i;
+			}
+		}
+
+		//Everything left is in use
+		if( oldest < 0 )
+		{
+			break;
+		}
+
+		evict( oldest );
+		mEvictions++;
+	}
+}
+
+void TextureCache::clear()
+{
+	for( size_t i = 0; i < mEntries.size(); ++i )
+	{
+		if( mEntries[ i ].texture != NULL )
+		{
+			evict( (int)i );
+		}
+	}
+	mEntries.clear();
+	mFreeSlots.clear();
+	mBytes = 0;
+}
+
+void TextureCache::evict( int index )
+{
+	Entry& entry = mEntries[ index ];
+	SDL_DestroyTexture( entry.texture );
+	mPaths.erase( entry.path );
+	mBytes -= entry.bytes;
+
+	entry.texture = NULL;
+	entry.path.clear();
+	entry.refs = 0;
+	mFreeSlots.push_back( index );
+}
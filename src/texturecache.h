@@ -0,0 +1,137 @@
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+#include <SDL2/SDL.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+class TextureCache;
+
+//Shared handle to a cached texture, which stays loaded while any handle holds it
+class TextureRef
+{
+	public:
+		//Initializes an empty handle
+		TextureRef();
+
+		//Shares another handle's texture
+		TextureRef( const TextureRef& other );
+		TextureRef& operator=( const TextureRef& other );
+
+		//Releases the texture
+		~TextureRef();
+
+		//Lets go of the texture
+		void release();
+
+		//Gets the texture and marks it used
+		SDL_Texture* get();
+
+		//Gets image dimensions
+		int getWidth();
+		int getHeight();
+
+		//Whether the handle holds a texture
+		bool isValid() { return mCache != NULL; }
+
+	private:
+		friend class TextureCache;
+
+		//Takes a reference on a cache entry
+		TextureRef( TextureCache* cache, int entry );
+
+		//The cache and entry held
+		TextureCache* mCache;
+		int mEntry;
+};
+
+//Owns textures by path so each image is uploaded once, and drops unused ones under a memory budget
+class TextureCache
+{
+	public:
+		//Initializes variables
+		TextureCache();
+
+		//Destroys the textures
+		~TextureCache();
+
+		//Sets the renderer textures are created for
+		void setRenderer( SDL_Renderer* renderer );
+
+		//Sets the color made transparent in loaded images
+		void setColorKey( Uint8 red, Uint8 green, Uint8 blue );
+
+		//Sets the most texture memory kept, unused textures are dropped least recently used first
+		void setBudget( size_t bytes );
+
+		//Gets the texture for a path, loading it if it isn't cached
+		TextureRef load( std::string path );
+
+		//Gets a cached texture without loading, empty if it isn't cached
+		TextureRef find( std::string path );
+
+		//Uploads a decoded image under a path, or shares the texture already there
+		TextureRef insert( std::string path, SDL_Surface* surface );
+
+		//Drops unused textures until under budget
+		void trim();
+
+		//Destroys every texture, as when the render device is lost, every handle must be released first
+		void clear();
+
+		//Memory statistics
+		size_t getMemoryUsage() { return mBytes; }
+		size_t getBudget() { return mBudget; }
+		int getCount() { return (int)mPaths.size(); }
+		int getHits() { return mHits; }
+		int getMisses() { return mMisses; }
+		int getEvictions() { return mEvictions; }
+
+	private:
+		friend class TextureRef;
+
+		//A cached texture
+		struct Entry
+		{
+			std::string path;
+			SDL_Texture* texture;
+			int width;
+			int height;
+			size_t bytes;
+
+			//Handles held and last use, for eviction
+			int refs;
+			Uint64 lastUsed;
+		};
+
+		//Destroys an entry's texture and frees its slot
+		void evict( int entry );
+
+		//The renderer textures belong to
+		SDL_Renderer* mRenderer;
+
+		//Color key
+		Uint32 mKeyRed, mKeyGreen, mKeyBlue;
+
+		//Entries and free slots
+		std::vector<Entry> mEntries;
+		std::vector<int> mFreeSlots;
+
+		//Entry of each cached path
+		std::unordered_map<std::string, int> mPaths;
+
+		//Use counter for least recently used order
+		Uint64 mClock;
+
+		//Memory use and limit in bytes
+		size_t mBytes;
+		size_t mBudget;
+
+		//Lookups that found a texture, lookups that had to load, textures dropped
+		int mHits;
+		int mMisses;
+		int mEvictions;
+};
+
+#endif
@@ -0,0 +1,107 @@
+#include "tilebatch.h"
+#include <stdio.h>
+
+TileBatch::TileBatch()
+{
+	//Geometry needs SDL 2.0.18 at build time and at run time
+	mGeometrySupported = false;
+
+	#if SDL_VERSION_ATLEAST( 2, 0, 18 )
+	SDL_version linked;
+	SDL_GetVersion( &linked );
+	mGeometrySupported = SDL_VERSIONNUM( linked.major, linked.minor, linked.patch ) >= SDL_VERSIONNUM( 2, 0, 18 );
+	#endif
+}
+
+void TileBatch::clear()
+{
+	mClips.clear();
+	mDests.clear();
+}
+
+void TileBatch::add( const SDL_Rect& clip, const SDL_Rect& dest )
+{
+	mClips.push_back( clip );
+	mDests.push_back( dest );
+}
+
+int TileBatch::draw( SDL_Renderer* renderer, SDL_Texture* texture, int textureWidth, int textureHeight )
+{
+	//Nothing to draw
+	if( mClips.empty() )
+	{
+		return 0;
+	}
+
+	#if SDL_VERSION_ATLEAST( 2, 0, 18 )
+	if( mGeometrySupported && textureWidth > 0 && textureHeight > 0 )
+	{
+		int quads = (int)mClips.size();
+
+		//Every quad uses the same index pattern, so only grow the index buffer
+		for( int i = (int)mIndices.size() / 6; i < quads; ++i )
+		{
+			int first = i * 4;
+			mIndices.push_back( first );
+			mIndices.push_back( first + 1 );
+			mIndices.push_back( first + 2 );
+			mIndices.push_back( first + 2 );
+			mIndices.push_back( first + 3 );
+			mIndices.push_back( first );
+		}
+
+		//Build the corners of each quad
+		mVertices.resize( quads * 4 );
+		float scaleU = 1.0f / textureWidth;
+		float scaleV = 1.0f / textureHeight;
+		SDL_Color white = { 0xFF, 0xFF, 0xFF, 0xFF };
+		for( int i = 0; i < quads; ++i )
+		{
+			const SDL_Rect& clip = mClips[ i ];
+			const SDL_Rect& dest = mDests[ i ];
+
+			float left = (float)dest.x;
+			float top = (float)dest.y;
+			float right = (float)( dest.x + dest.w );
+			float bottom = (float)( dest.y + dest.h );
+
+			float u0 = clip.x * scaleU;
+			float v0 = clip.y * scaleV;
+			float u1 = ( clip.x + clip.w ) * scaleU;
+			float v1 = ( clip.y + clip.h ) * scaleV;
+
+			SDL_Vertex* corner = &mVertices[ i * 4 ];
+			corner[ 0 ].position.x = left;  corner[ 0 ].position.y = top;    corner[ 0 ].tex_coord.x = u0; corner[ 0 ].tex_coord.y = v0;
+			corner[ 1 ].position.x = right; corner[ 1 ].position.y = top;    corner[ 1 ].tex_coord.x = u1; corner[ 1 ].tex_coord.y = v0;
+			corner[ 2 ].position.x = right; corner[ 2 ].position.y = bottom; corner[ 2 ].tex_coord.x = u1; corner[ 2 ].tex_coord.y = v1;
+			corner[ 3 ].position.x = left;  corner[ 3 ].position.y = bottom; corner[ 3 ].tex_coord.x = u0; corner[ 3 ].tex_coord.y = v1;
+			for( int c = 0; c < 4; ++c )
+			{
+				corner[ c ].color = white;
+			}
+		}
+
+		//Submit the whole batch at once
+		if( SDL_RenderGeometry( renderer, texture, &mVertices[ 0 ], quads * 4, &mIndices[ 0 ], quads * 6 ) == 0 )
+		{
+			return 1;
+		}
+
+		//The renderer can't draw geometry, so stop trying
+		printf( "Warning: Batched rendering failed, drawing tiles one by one! SDL Error: %s\n", SDL_GetError() );
+		mGeometrySupported = false;
+	}
+	#endif
+
+	return drawEach( renderer, texture );
+}
+
+int TileBatch::drawEach( SDL_Renderer* renderer, SDL_Texture* texture )
+{
+	for( size_t i = 0; i < mClips.size(); ++i )
+	{
+		SDL_RenderCopy( renderer, texture, &mClips[ i ], &mDests[ i ] );
+	}
+
+	return (int)mClips.size();
+}
@@ -0,0 +1,44 @@
+#ifndef TILEBATCH_H
+#define TILEBATCH_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+//Collects sprites from one texture and draws them with a single geometry call
+class TileBatch
+{
+	public:
+		//Initializes variables
+		TileBatch();
+
+		//Starts a new batch, keeping the buffers allocated
+		void clear();
+
+		//Queues a sprite clip to be drawn at the given screen rect
+		void add( const SDL_Rect& clip, const SDL_Rect& dest );
+
+		//Draws the queued sprites and returns the number of draw calls made
+		int draw( SDL_Renderer* renderer, SDL_Texture* texture, int textureWidth, int textureHeight );
+
+		//Gets the number of queued sprites
+		int getCount() { return (int)mClips.size(); }
+
+	private:
+		//Draws every queued sprite with its own copy call
+		int drawEach( SDL_Renderer* renderer, SDL_Texture* texture );
+
+		//The queued sprites
+		std::vector<SDL_Rect> mClips;
+		std::vector<SDL_Rect> mDests;
+
+		//The geometry buffers, reused between frames
+		#if SDL_VERSION_ATLEAST( 2, 0, 18 )
+		std::vector<SDL_Vertex> mVertices;
+		std::vector<int> mIndices;
+		#endif
+
+		//Whether the linked SDL can draw geometry
+		bool mGeometrySupported;
+};
+
+#endif
@@ -0,0 +1,95 @@
+#include "tilemask.h"
+
+TileMask::TileMask()
+{
+	//Initialize
+	mPitch = 0;
+	mColumns = 0;
+	mRows = 0;
+}
+
+void TileMask::init( int columns, int rows )
+{
+	mColumns = columns;
+	mRows = rows;
+	mPitch = ( columns + 63 ) / 64;
+	mWords.assign( (size_t)mPitch * rows, 0 );
+}
+
+void TileMask::free()
+{
+	std::vector<Uint64>().swap( mWords );
+	mPitch = 0;
+	mColumns = 0;
+	mRows = 0;
+}
+
+bool TileMask::anyInArea( int firstCol, int firstRow, int lastCol, int lastRow )
+{
+	for( int row = firstRow; row <= lastRow; ++row )
+	{
+		if( findInRow( row, firstCol, lastCol ) >= 0 )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+int TileMask::findInRow( int row, int firstCol, int lastCol )
+{
+	if( firstCol > lastCol )
+	{
+		return -1;
+	}
+
+	//Mask off the cells before the first column and past the last one
+	const Uint64* words = &mWords[ (size_t)row * mPitch ];
+	int lastWord = lastCol >> 6;
+	Uint64 lastMask = ~(Uint64)0 >> ( 63 - ( lastCol & 63 ) );
+	Uint64 bits = words[ firstCol >> 6 ] & ( ~(Uint64)0 << ( firstCol & 63 ) );
+	for( int word = firstCol >> 6; ; bits = words[ ++word ] )
+	{
+		if( word == lastWord )
+		{
+			bits &= lastMask;
+		}
+		if( bits != 0 )
+		{
+			return word * 64 + __builtin_ctzll( bits );
+		}
+		if( word == lastWord )
+		{
+			return -1;
+		}
+	}
+}
+
+int TileMask::findLastInRow( int row, int firstCol, int lastCol )
+{
+	if( firstCol > lastCol )
+	{
+		return -1;
+	}
+
+	//The same from the other end
+	const Uint64* words = &mWords[ (size_t)row * mPitch ];
+	int firstWord = firstCol >> 6;
+	Uint64 firstMask = ~(Uint64)0 << ( firstCol & 63 );
+	Uint64 bits = words[ lastCol >> 6 ] & ( ~(Uint64)0 >> ( 63 - ( lastCol & 63 ) ) );
+	for( int word = lastCol >> 6; ; bits = words[ --word ] )
+	{
+		if( word == firstWord )
+		{
+			bits &= firstMask;
+		}
+		if( bits != 0 )
+		{
+			return word * 64 + 63 - __builtin_clzll( bits );
+		}
+		if( word == firstWord )
+		{
+			return -1;
+		}
+	}
+}
@@ -0,0 +1,59 @@
+#ifndef TILEMASK_H
+#define TILEMASK_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+//One bit per tile cell, packed 64 cells to a word along each row
+//A whole map's worth stays in cache, and questions about a span of a row take a few word operations
+class TileMask
+{
+	public:
+		//Initializes an empty mask
+		TileMask();
+
+		//Sizes the mask for a grid with every bit clear
+		void init( int columns, int rows );
+
+		//Deallocates the bits
+		void free();
+
+		//Sets or clears a cell
+		void set( int col, int row, bool value )
+		{
+			Uint64& word = mWords[ (size_t)row * mPitch + ( col >> 6 ) ];
+			Uint64 bit = (Uint64)1 << ( col & 63 );
+			word = value ? word | bit : word & ~bit;
+		}
+
+		//Whether a cell is set
+		bool test( int col, int row ) { return ( mWords[ (size_t)row * mPitch + ( col >> 6 ) ] >> ( col & 63 ) ) & 1; }
+
+		//Whether any cell from firstCol to lastCol of a row is set
+		bool anyInRow( int row, int firstCol, int lastCol ) { return findInRow( row, firstCol, lastCol ) >= 0; }
+
+		//Whether any cell of an area is set
+		bool anyInArea( int firstCol, int firstRow, int lastCol, int lastRow );
+
+		//Gets the first or last set column from firstCol to lastCol of a row, -1 if none is set
+		int findInRow( int row, int firstCol, int lastCol );
+		int findLastInRow( int row, int firstCol, int lastCol );
+
+		//Gets mask dimensions
+		int getColumns() { return mColumns; }
+		int getRows() { return mRows; }
+
+		//Gets the bytes used by the bits
+		size_t getMemoryUsage() { return mWords.capacity() * sizeof( Uint64 ); }
+
+	private:
+		//Bits row by row, each row starting on a new word
+		std::vector<Uint64> mWords;
+		int mPitch;
+
+		//Mask dimensions in cells
+		int mColumns;
+		int mRows;
+};
+
+#endif
@@ -0,0 +1,66 @@
+#include "tileruns.h"
+#include <stdio.h>
+#include <algorithm>
+
+TileRuns::TileRuns()
+{
+}
+
+bool TileRuns::build( const Uint8* tiles, int columns, int rows )
+{
+	free();
+
+	//Run ends are 16 bit
+	if( columns > MAX_RUN_COLUMNS )
+	{
+		printf( "Unable to compress tiles: %d columns is over %d!\n", columns, MAX_RUN_COLUMNS );
+		return false;
+	}
+
+	mRowStarts.reserve( rows + 1 );
+	for( int row = 0; row < rows; ++row )
+	{
+		mRowStarts.push_back( (Uint32)mEnds.size() );
+
+		//Start a new run wherever the type changes, runs never cross rows
+		const Uint8* line = tiles + (size_t)row * columns;
+		for( int col = 0; col < columns; ++col )
+		{
+			if( col + 1 == columns || line[ col + 1 ] != line[ col ] )
+			{
+				mEnds.push_back( (Uint16)( col + 1 ) );
+				mTypes.push_back( line[ col ] );
+			}
+		}
+	}
+	mRowStarts.push_back( (Uint32)mEnds.size() );
+
+	//Don't keep the growth slack
+	std::vector<Uint16>( mEnds ).swap( mEnds );
+	std::vector<Uint8>( mTypes ).swap( mTypes );
+
+	return true;
+}
+
+void TileRuns::free()
+{
+	std::vector<Uint32>().swap( mRowStarts );
+	std::vector<Uint16>().swap( mEnds );
+	std::vector<Uint8>().swap( mTypes );
+}
+
+int TileRuns::getRun( int col, int row, int& end )
+{
+	//The first run of the row ending past the column holds it
+	const Uint16* first = &mEnds[ 0 ] + mRowStarts[ row ];
+	const Uint16* last = &mEnds[ 0 ] + mRowStarts[ row + 1 ];
+	const Uint16* run = std::upper_bound( first, last, (Uint16)col );
+
+	end = (int)*run;
+	return mTypes[ run - &mEnds[ 0 ] ];
+}
+
+size_t TileRuns::getMemoryUsage()
+{
+	return mRowStarts.capacity() * sizeof( Uint32 ) + mEnds.capacity() * sizeof( Uint16 ) + mTypes.capacity() * sizeof( Uint8 );
+}
@@ -0,0 +1,53 @@
+#ifndef TILERUNS_H
+#define TILERUNS_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+//Most columns a row of runs can hold
+const int MAX_RUN_COLUMNS = 65535;
+
+//Tile types stored as runs of the same type along each row
+//Maps made of long stretches of grass, path and water shrink to three bytes a run,
+//lookups binary search the runs of one row
+class TileRuns
+{
+	public:
+		//Initializes empty storage
+		TileRuns();
+
+		//Encodes tiles stored row by row, false if the rows are too wide
+		bool build( const Uint8* tiles, int columns, int rows );
+
+		//Deallocates the runs
+		void free();
+
+		//Gets the tile type at a grid cell
+		int getType( int col, int row )
+		{
+			int end;
+			return getRun( col, row, end );
+		}
+
+		//Gets the tile type at a grid cell and the column just past the run holding it
+		int getRun( int col, int row, int& end );
+
+		//Whether any tiles are stored
+		bool isEmpty() { return mRowStarts.empty(); }
+
+		//Gets the number of runs
+		int getRunCount() { return (int)mEnds.size(); }
+
+		//Gets the bytes used by the runs
+		size_t getMemoryUsage();
+
+	private:
+		//Index of the first run of each row, with one past the last row at the end
+		std::vector<Uint32> mRowStarts;
+
+		//Column just past each run and the tile type of each run, kept apart so searches only touch the ends
+		std::vector<Uint16> mEnds;
+		std::vector<Uint8> mTypes;
+};
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef TILETRAITS_H
+#define TILETRAITS_H
+
+#include <SDL2/SDL.h>
+
+//Tile types a map can hold
+const int TOTAL_TILE_SPRITES = 100;
+
+//tile sprites
+const int TILE_GRASS = 0;
+const int TILE_GRASS_PLANT1 = 1;
+const int TILE_PATH2 = 2;
+const int TILE_CENTER = 3;
+const int TILE_TOP = 4;
+const int TILE_TOPRIGHT = 5;
+const int TILE_RIGHT = 6;
+const int TILE_BOTTOMRIGHT = 7;
+const int TILE_BOTTOM = 8;
+const int TILE_BOTTOMLEFT = 9;
+const int TILE_LEFT = 10;
+const int TILE_TOPLEFT = 11;
+const int TILE_GRASS_TREE1 = 12;
+const int TILE_GRASS_TREE2 = 13;
+const int TILE_GRASS_TREE3 = 14;
+const int TILE_BOAT_PART1 = 15;
+const int TILE_BOAT_PART2 = 16;
+const int TILE_DOCK = 17;
+const int TILE_PATH = 18;
+
+//Tile types with a name and traits
+const int TOTAL_TILE_TYPES = 19;
+
+//Layers tiles belong to, bottom first
+const Uint8 TILE_LAYER_GROUND = 0;
+const Uint8 TILE_LAYER_WALL = 1;
+const Uint8 TILE_LAYER_PROP = 2;
+
+//What a type of tile is like
+struct TileTraits
+{
+	//Blocks movement
+	bool solid;
+
+	//Has more than one frame
+	bool animated;
+
+	//Hides whatever is under it
+	bool opaque;
+
+	//Layer it belongs to
+	Uint8 layer;
+
+	//Relative cost of walking across, path is cheapest, 0 when it can't be walked at all
+	Uint8 cost;
+};
+
+//Traits by tile type
+constexpr TileTraits TILE_TRAITS[ TOTAL_TILE_TYPES ] =
+{
+	{ false, false, true, TILE_LAYER_GROUND, 2 },	//TILE_GRASS
+	{ false, false, true, TILE_LAYER_GROUND, 3 },	//TILE_GRASS_PLANT1
+	{ false, false, true, TILE_LAYER_GROUND, 1 },	//TILE_PATH2
+	{ true, false, true, TILE_LAYER_WALL, 0 },		//TILE_CENTER
+	{ true, false, true, TILE_LAYER_WALL, 0 },		//TILE_TOP
+	{ true, false, true, TILE_LAYER_WALL, 0 },		//TILE_TOPRIGHT
+	{ true, false, true, TILE_LAYER_WALL, 0 },		//TILE_RIGHT
+	{ true, false, true, TILE_LAYER_WALL, 0 },		//TILE_BOTTOMRIGHT
+	{ true, false, true, TILE_LAYER_WALL, 0 },		//TILE_BOTTOM
+	{ true, false, true, TILE_LAYER_WALL, 0 },		//TILE_BOTTOMLEFT
+	{ true, false, true, TILE_LAYER_WALL, 0 },		//TILE_LEFT
+	{ true, false, true, TILE_LAYER_WALL, 0 },		//TILE_TOPLEFT
+	{ false, false, true, TILE_LAYER_PROP, 4 },		//TILE_GRASS_TREE1
+	{ false, false, true, TILE_LAYER_PROP, 4 },		//TILE_GRASS_TREE2
+	{ false, false, true, TILE_LAYER_PROP, 4 },		//TILE_GRASS_TREE3
+	{ false, false, true, TILE_LAYER_PROP, 2 },		//TILE_BOAT_PART1
+	{ false, false, true, TILE_LAYER_PROP, 2 },		//TILE_BOAT_PART2
+	{ false, false, true, TILE_LAYER_GROUND, 1 },	//TILE_DOCK
+	{ false, false, true, TILE_LAYER_GROUND, 1 }	//TILE_PATH
+};
+
+//Traits of tile types without a name, plain walkable ground
+constexpr TileTraits TILE_UNKNOWN_TRAITS = { false, false, true, TILE_LAYER_GROUND, 2 };
+
+//Gets the traits of a tile type, usable in constant expressions
+constexpr const TileTraits& getTileTraits( int type )
+{
+	return type >= 0 && type < TOTAL_TILE_TYPES ? TILE_TRAITS[ type ] : TILE_UNKNOWN_TRAITS;
+}
+
+static_assert( getTileTraits( TILE_CENTER ).solid && getTileTraits( TILE_TOPLEFT ).solid && !getTileTraits( TILE_GRASS_TREE1 ).solid, "Walls are the solid tiles" );
+static_assert( getTileTraits( TILE_PATH ).cost == 1 && getTileTraits( TILE_DOCK ).cost == 1, "Path and dock are the cheapest tiles to walk" );
+
+#endif
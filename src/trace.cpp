@@ -0,0 +1,165 @@
+#include "trace.h"
+#include <stdio.h>
+#include <vector>
+
+bool gTraceEnabled = false;
+
+//A begin or end event
+struct TraceEvent
+{
+	const char* name;
+	char phase;
+	Uint64 time;
+};
+
+//Events of one thread, only written by that thread
+struct TraceBuffer
+{
+	int thread;
+	const char* threadName;
+	std::vector<TraceEvent> events;
+};
+
+//Events kept per thread before the buffer has to grow
+static const int TRACE_RESERVE = 1 << 16;
+
+//Every thread's buffer, registered on the thread's first event
+static std::vector<TraceBuffer*> gTraceBuffers;
+static SDL_mutex* gTraceLock = NULL;
+
+//Where the events go
+static const char* gTracePath = NULL;
+
+//When tracing started
+static Uint64 gTraceStart = 0;
+
+//The calling thread's buffer
+static thread_local TraceBuffer* tTraceBuffer = NULL;
+
+//Gets the calling thread's buffer, registering it the first time
+static TraceBuffer* getBuffer()
+{
+	if( tTraceBuffer == NULL )
+	{
+		TraceBuffer* buffer = new TraceBuffer;
+		buffer->threadName = NULL;
+		buffer->events.reserve( TRACE_RESERVE );
+
+		SDL_LockMutex( gTraceLock );
+		buffer->thread = (int)gTraceBuffers.size() + 1;
+		gTraceBuffers.push_back( buffer );
+		SDL_UnlockMutex( gTraceLock );
+
+		tTraceBuffer = buffer;
+	}
+
+	return tTraceBuffer;
+}
+
+//Adds an event to the calling thread's buffer
+static void record( const char* name, char phase )
+{
+	TraceEvent event = { name, phase, SDL_GetPerformanceCounter() };
+	getBuffer()->events.push_back( event );
+}
+
+bool traceInit( const char* path )
+{
+	gTraceLock = SDL_CreateMutex();
+	if( gTraceLock == NULL )
+	{
+		printf( "Unable to create trace lock! SDL Error: %s\n", SDL_GetError() );
+		return false;
+	}
+
+	gTracePath = path;
+	gTraceStart = SDL_GetPerformanceCounter();
+	gTraceEnabled = true;
+	traceThreadName( "main" );
+
+	return true;
+}
+
+bool traceShutdown()
+{
+	if( !gTraceEnabled )
+	{
+		return true;
+	}
+
+	//Stop recording, any worker threads must have finished by now
+	gTraceEnabled = false;
+
+	bool written = false;
+	FILE* file = fopen( gTracePath, "w" );
+	if( file == NULL )
+	{
+		printf( "Unable to open trace file %s!\n", gTracePath );
+	}
+	else
+	{
+		//Timestamps are in microseconds
+		double counterUs = 1000000.0 / SDL_GetPerformanceFrequency();
+		bool first = true;
+
+		fprintf( file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" );
+		for( size_t i = 0; i < gTraceBuffers.size(); ++i )
+		{
+			TraceBuffer* buffer = gTraceBuffers[ i ];
+			if( buffer->threadName != NULL )
+			{
+				fprintf( file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", first ? "" : ",\n", buffer->thread, buffer->threadName );
+				first = false;
+			}
+
+			for( size_t j = 0; j < buffer->events.size(); ++j )
+			{
+				TraceEvent& event = buffer->events[ j ];
+				fprintf( file, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d}", first ? "" : ",\n",
+					event.name, event.phase, ( event.time - gTraceStart ) * counterUs, buffer->thread );
+				first = false;
+			}
+		}
+		fprintf( file, "\n]}\n" );
+
+		written = fclose( file ) == 0;
+		if( !written )
+		{
+			printf( "Unable to write trace file %s!\n", gTracePath );
+		}
+		else
+		{
+			printf( "Trace written to %s\n", gTracePath );
+		}
+	}
+
+	//Free the buffers
+	for( size_t i = 0; i < gTraceBuffers.size(); ++i )
+	{
+		delete gTraceBuffers[ i ];
+	}
+	gTraceBuffers.clear();
+	tTraceBuffer = NULL;
+	SDL_DestroyMutex( gTraceLock );
+	gTraceLock = NULL;
+
+	return written;
+}
+
+void traceThreadName( const char* name )
+{
+	if( gTraceEnabled )
+	{
+		getBuffer()->threadName = name;
+	}
+}
+
+void traceBegin( const char* name )
+{
+	record( name, 'B' );
+}
+
+void traceEnd( const char* name )
+{
+	record( name, 'E' );
+}
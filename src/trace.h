@@ -0,0 +1,62 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <SDL2/SDL.h>
+
+//Records begin/end events from every thread and writes them out as Chrome
+//trace event JSON, viewable in chrome://tracing or Perfetto. Event names
+//must be string literals or otherwise outlive tracing.
+
+//Whether events are being recorded
+extern bool gTraceEnabled;
+
+//Starts recording, the events are written to path by traceShutdown
+bool traceInit( const char* path );
+
+//Writes the recorded events and stops recording
+bool traceShutdown();
+
+//Names the calling thread in the trace
+void traceThreadName( const char* name );
+
+//Records the start and end of a span on the calling thread
+void traceBegin( const char* name );
+void traceEnd( const char* name );
+
+//Records a span from construction to the end of the scope
+class TraceScope
+{
+	public:
+		//Begins the span if tracing
+		TraceScope( const char* name )
+		{
+			mName = gTraceEnabled ? name : NULL;
+			if( mName != NULL )
+			{
+				traceBegin( mName );
+			}
+		}
+
+		//Ends the span
+		~TraceScope()
+		{
+			if( mName != NULL )
+			{
+				traceEnd( mName );
+			}
+		}
+
+	private:
+		const char* mName;
+};
+
+//Traces the rest of the enclosing scope, compiled out with NO_TRACE
+#ifdef NO_TRACE
+#define TRACE_SCOPE( name )
+#else
+#define TRACE_CONCAT( a, b ) a##b
+#define TRACE_NAME( line ) TRACE_CONCAT( traceScope, line )
+#define TRACE_SCOPE( name ) TraceScope TRACE_NAME( __LINE__ )( name )
+#endif
+
+#endif
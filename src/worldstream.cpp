@@ -0,0 +1,439 @@
+#include "worldstream.h"
+#include "trace.h"
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <sys/types.h>
+
+WorldStream::WorldStream()
+{
+	//Initialize
+	mFile = NULL;
+	mTileTypes = 0;
+	mColumns = 0;
+	mRows = 0;
+	mTileWidth = 0;
+	mTileHeight = 0;
+	mChunkColumns = 0;
+	mChunkRows = 0;
+	mChunkShift = 0;
+	mChunkMask = 0;
+	mChunkBytes = 0;
+	mGeneration = 0;
+	mBudget = DEFAULT_STREAM_BUDGET;
+	mHasLastCamera = false;
+	mLock = NULL;
+	mRequestReady = NULL;
+	mQuit = false;
+	mReader = NULL;
+	mLoaded = NULL;
+	mLoadedData = NULL;
+}
+
+WorldStream::~WorldStream()
+{
+	close();
+}
+
+bool WorldStream::open( std::string path, int tileTypes )
+{
+	//Get rid of a preexisting world
+	close();
+
+	mFile = fopen( path.c_str(), "rb" );
+	if( mFile == NULL )
+	{
+		printf( "Unable to load world file %s!\n", path.c_str() );
+		return false;
+	}
+
+	//Check the header
+	WorldHeader header;
+	bool success = false;
+	if( fread( &header, sizeof( header ), 1, mFile ) != 1 || memcmp( header.magic, WORLD_MAGIC, sizeof( header.magic ) ) != 0 )
+	{
+		printf( "Error loading world: Not a world file!\n" );
+	}
+	else if( header.version != WORLD_VERSION )
+	{
+		printf( "Error loading world: Unsupported version %u!\n", header.version );
+	}
+	else if( header.columns == 0 || header.rows == 0 || header.layers == 0 || header.chunkTiles == 0 || ( header.chunkTiles & ( header.chunkTiles - 1 ) ) != 0 ||
+		header.columns > 0x7FFFFFFF / header.rows )
+	{
+		printf( "Error loading world: Bad dimensions!\n" );
+	}
+	else
+	{
+		mColumns = header.columns;
+		mRows = header.rows;
+		mTileWidth = header.tileWidth;
+		mTileHeight = header.tileHeight;
+		mChunkShift = 0;
+		while( ( 1 << mChunkShift ) < header.chunkTiles )
+		{
+			mChunkShift++;
+		}
+		mChunkMask = header.chunkTiles - 1;
+		mChunkBytes = (size_t)header.chunkTiles * header.chunkTiles;
+		mChunkColumns = ( mColumns + mChunkMask ) >> mChunkShift;
+		mChunkRows = ( mRows + mChunkMask ) >> mChunkShift;
+		mTileTypes = tileTypes;
+
+		//Read the chunk index
+		int chunks = mChunkColumns * mChunkRows;
+		mIndex.resize( chunks );
+		if( fseek( mFile, header.indexOffset, SEEK_SET ) != 0 || fread( &mIndex[ 0 ], sizeof( WorldChunk ), chunks, mFile ) != (size_t)chunks )
+		{
+			printf( "Error loading world: Truncated chunk index!\n" );
+		}
+		else
+		{
+			success = true;
+		}
+	}
+
+	if( !success )
+	{
+		close();
+		return false;
+	}
+
+	//Nothing resident yet
+	int chunks = mChunkColumns * mChunkRows;
+	mTiles.assign( chunks, (Uint8*)NULL );
+	mState.assign( chunks, (Uint8)CHUNK_ABSENT );
+	mWanted.assign( chunks, 0 );
+
+	//Start the reader
+	mLock = SDL_CreateMutex();
+	mRequestReady = SDL_CreateCond();
+	mQuit = false;
+	mReader = mLock != NULL && mRequestReady != NULL ? SDL_CreateThread( readerMain, "stream", this ) : NULL;
+	if( mReader == NULL )
+	{
+		printf( "Unable to start world reader! SDL Error: %s\n", SDL_GetError() );
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void WorldStream::close()
+{
+	//Stop the reader
+	if( mReader != NULL )
+	{
+		SDL_LockMutex( mLock );
+		mQuit = true;
+		SDL_CondSignal( mRequestReady );
+		SDL_UnlockMutex( mLock );
+		SDL_WaitThread( mReader, NULL );
+		mReader = NULL;
+	}
+	if( mRequestReady != NULL )
+	{
+		SDL_DestroyCond( mRequestReady );
+		mRequestReady = NULL;
+	}
+	if( mLock != NULL )
+	{
+		SDL_DestroyMutex( mLock );
+		mLock = NULL;
+	}
+
+	//Free the chunks, including ones read but not installed
+	for( size_t i = 0; i < mTiles.size(); ++i )
+	{
+		delete[] mTiles[ i ];
+	}
+	for( size_t i = 0; i < mArrived.size(); ++i )
+	{
+		delete[] mArrived[ i ].second;
+	}
+	std::vector<Uint8*>().swap( mTiles );
+	std::vector<Uint8>().swap( mState );
+	std::vector<Uint32>().swap( mWanted );
+	std::vector<WorldChunk>().swap( mIndex );
+	mResident.clear();
+	mRequests.clear();
+	mArrived.clear();
+	mHasLastCamera = false;
+
+	if( mFile != NULL )
+	{
+		fclose( mFile );
+		mFile = NULL;
+	}
+	mColumns = 0;
+	mRows = 0;
+}
+
+void WorldStream::update( const SDL_Rect& camera )
+{
+	TRACE_SCOPE( "WorldStream::update" );
+
+	//Install the chunks the reader finished
+	std::vector< std::pair<int, Uint8*> > arrived;
+	SDL_LockMutex( mLock );
+	arrived.swap( mArrived );
+	SDL_UnlockMutex( mLock );
+	for( size_t i = 0; i < arrived.size(); ++i )
+	{
+		int chunk = arrived[ i ].first;
+		mTiles[ chunk ] = arrived[ i ].second;
+		mState[ chunk ] = mTiles[ chunk ] != NULL ? CHUNK_RESIDENT : CHUNK_FAILED;
+		if( mTiles[ chunk ] == NULL )
+		{
+			continue;
+		}
+		mResident.push_back( chunk );
+
+		if( mLoaded != NULL )
+		{
+			int firstCol = ( chunk % mChunkColumns ) << mChunkShift;
+			int firstRow = ( chunk / mChunkColumns ) << mChunkShift;
+			mLoaded( firstCol, firstRow, std::min( firstCol + mChunkMask, mColumns - 1 ), std::min( firstRow + mChunkMask, mRows - 1 ), mLoadedData );
+		}
+	}
+
+	//Want the chunks around the camera first, then those ahead of where it's heading
+	mGeneration++;
+	std::vector<int> requests;
+	int chunkWidth = mTileWidth << mChunkShift;
+	int chunkHeight = mTileHeight << mChunkShift;
+	SDL_Rect around = { camera.x - chunkWidth, camera.y - chunkHeight, camera.w + chunkWidth * 2, camera.h + chunkHeight * 2 };
+	int firstCol, firstRow, lastCol, lastRow;
+	if( getChunkSpan( around, firstCol, firstRow, lastCol, lastRow ) )
+	{
+		want( firstCol, firstRow, lastCol, lastRow, requests );
+	}
+	if( mHasLastCamera )
+	{
+		SDL_Rect ahead = camera;
+		ahead.x += ( camera.x - mLastCamera.x ) * STREAM_PREFETCH_UPDATES;
+		ahead.y += ( camera.y - mLastCamera.y ) * STREAM_PREFETCH_UPDATES;
+		if( ( ahead.x != camera.x || ahead.y != camera.y ) && getChunkSpan( ahead, firstCol, firstRow, lastCol, lastRow ) )
+		{
+			want( firstCol, firstRow, lastCol, lastRow, requests );
+		}
+	}
+	mLastCamera = camera;
+	mHasLastCamera = true;
+
+	//Replace requests the camera has left behind with the new ones
+	SDL_LockMutex( mLock );
+	for( std::deque<int>::iterator i = mRequests.begin(); i != mRequests.end(); )
+	{
+		if( mWanted[ *i ] != mGeneration )
+		{
+			mState[ *i ] = CHUNK_ABSENT;
+			i = mRequests.erase( i );
+		}
+		else
+		{
+			++i;
+		}
+	}
+	for( size_t i = 0; i < requests.size(); ++i )
+	{
+		mState[ requests[ i ] ] = CHUNK_REQUESTED;
+		mRequests.push_back( requests[ i ] );
+	}
+	if( !requests.empty() )
+	{
+		SDL_CondSignal( mRequestReady );
+	}
+	SDL_UnlockMutex( mLock );
+
+	//Over budget, drop unwanted chunks furthest from the camera first
+	if( mResident.size() * mChunkBytes > mBudget )
+	{
+		int centerCol = ( ( camera.x + camera.w / 2 ) / chunkWidth );
+		int centerRow = ( ( camera.y + camera.h / 2 ) / chunkHeight );
+		std::vector< std::pair<int, int> > unwanted;
+		for( size_t i = 0; i < mResident.size(); ++i )
+		{
+			int chunk = mResident[ i ];
+			if( mWanted[ chunk ] != mGeneration )
+			{
+				int distance = abs( chunk % mChunkColumns - centerCol ) + abs( chunk / mChunkColumns - centerRow );
+				unwanted.push_back( std::make_pair( -distance, chunk ) );
+			}
+		}
+		std::sort( unwanted.begin(), unwanted.end() );
+		for( size_t i = 0; i < unwanted.size() && mResident.size() * mChunkBytes > mBudget; ++i )
+		{
+			evict( unwanted[ i ].second );
+		}
+	}
+}
+
+void WorldStream::wait( const SDL_Rect& camera )
+{
+	TRACE_SCOPE( "WorldStream::wait" );
+
+	int firstCol, firstRow, lastCol, lastRow;
+	if( !getChunkSpan( camera, firstCol, firstRow, lastCol, lastRow ) )
+	{
+		return;
+	}
+
+	//Until nothing under the camera is still on its way
+	bool waiting = true;
+	while( waiting )
+	{
+		update( camera );
+
+		waiting = false;
+		for( int row = firstRow; row <= lastRow && !waiting; ++row )
+		{
+			for( int col = firstCol; col <= lastCol && !waiting; ++col )
+			{
+				waiting = mState[ row * mChunkColumns + col ] == CHUNK_REQUESTED;
+			}
+		}
+		if( waiting )
+		{
+			SDL_Delay( 1 );
+		}
+	}
+}
+
+void WorldStream::setLoadedCallback( ChunkLoaded callback, void* data )
+{
+	mLoaded = callback;
+	mLoadedData = data;
+}
+
+size_t WorldStream::getMemoryUsage()
+{
+	return sizeof( WorldStream ) + mResident.size() * mChunkBytes + mIndex.capacity() * sizeof( WorldChunk ) +
+		mTiles.capacity() * sizeof( Uint8* ) + mState.capacity() + mWanted.capacity() * sizeof( Uint32 );
+}
+
+int WorldStream::readerMain( void* stream )
+{
+	WorldStream* self = (WorldStream*)stream;
+	traceThreadName( "stream" );
+
+	SDL_LockMutex( self->mLock );
+	while( true )
+	{
+		//Wait for a request or the quit signal
+		while( self->mRequests.empty() && !self->mQuit )
+		{
+			SDL_CondWait( self->mRequestReady, self->mLock );
+		}
+		if( self->mQuit )
+		{
+			break;
+		}
+
+		int chunk = self->mRequests.front();
+		self->mRequests.pop_front();
+
+		//Read without holding the lock
+		SDL_UnlockMutex( self->mLock );
+		Uint8* tiles = self->read( chunk );
+		SDL_LockMutex( self->mLock );
+
+		self->mArrived.push_back( std::make_pair( chunk, tiles ) );
+	}
+	SDL_UnlockMutex( self->mLock );
+
+	return 0;
+}
+
+Uint8* WorldStream::read( int chunk )
+{
+	TRACE_SCOPE( "WorldStream::read" );
+
+	const WorldChunk& entry = mIndex[ chunk ];
+	if( entry.size < mChunkBytes )
+	{
+		printf( "Error loading world: Chunk %d is too small!\n", chunk );
+		return NULL;
+	}
+
+	//Only the first layer is kept
+	Uint8* tiles = new Uint8[ mChunkBytes ];
+	bool success = fseeko( mFile, (off_t)entry.offset, SEEK_SET ) == 0 && fread( tiles, 1, mChunkBytes, mFile ) == mChunkBytes;
+	if( !success )
+	{
+		printf( "Error loading world: Chunk %d is truncated!\n", chunk );
+	}
+	else if( entry.size == mChunkBytes && mapChecksum( tiles, mChunkBytes ) != entry.checksum )
+	{
+		printf( "Error loading world: Chunk %d checksum mismatch!\n", chunk );
+		success = false;
+	}
+	else
+	{
+		for( size_t i = 0; i < mChunkBytes && success; ++i )
+		{
+			success = tiles[ i ] < mTileTypes;
+		}
+		if( !success )
+		{
+			printf( "Error loading world: Invalid tile type in chunk %d!\n", chunk );
+		}
+	}
+
+	if( !success )
+	{
+		delete[] tiles;
+		return NULL;
+	}
+
+	return tiles;
+}
+
+bool WorldStream::getChunkSpan( SDL_Rect area, int& firstCol, int& firstRow, int& lastCol, int& lastRow )
+{
+	//Clip the area to the world
+	int left = std::max( area.x, 0 );
+	int top = std::max( area.y, 0 );
+	int right = std::min( area.x + area.w, mColumns * mTileWidth );
+	int bottom = std::min( area.y + area.h, mRows * mTileHeight );
+	if( right <= left || bottom <= top )
+	{
+		return false;
+	}
+
+	firstCol = left / ( mTileWidth << mChunkShift );
+	firstRow = top / ( mTileHeight << mChunkShift );
+	lastCol = ( right - 1 ) / ( mTileWidth << mChunkShift );
+	lastRow = ( bottom - 1 ) / ( mTileHeight << mChunkShift );
+	return true;
+}
+
+void WorldStream::want( int firstCol, int firstRow, int lastCol, int lastRow, std::vector<int>& requests )
+{
+	for( int row = firstRow; row <= lastRow; ++row )
+	{
+		for( int col = firstCol; col <= lastCol; ++col )
+		{
+			int chunk = row * mChunkColumns + col;
+			if( mWanted[ chunk ] == mGeneration )
+			{
+				continue;
+			}
+			mWanted[ chunk ] = mGeneration;
+
+			if( mState[ chunk ] == CHUNK_ABSENT )
+			{
+				requests.push_back( chunk );
+			}
+		}
+	}
+}
+
+void WorldStream::evict( int chunk )
+{
+	delete[] mTiles[ chunk ];
+	mTiles[ chunk ] = NULL;
+	mState[ chunk ] = CHUNK_ABSENT;
+	mResident.erase( std::find( mResident.begin(), mResident.end(), chunk ) );
+}
@@ -0,0 +1,141 @@
+#ifndef WORLDSTREAM_H
+#define WORLDSTREAM_H
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include "mapformat.h"
+
+//Chunk side in tiles for new world files, a power of two
+const int WORLD_CHUNK_TILES = 32;
+
+//Default bytes of chunk tiles kept resident
+const size_t DEFAULT_STREAM_BUDGET = 4 * 1024 * 1024;
+
+//Updates of camera motion looked ahead when prefetching
+const int STREAM_PREFETCH_UPDATES = 30;
+
+//Called from update when a chunk's tiles arrive, with the tile area it covers
+typedef void (*ChunkLoaded)( int firstCol, int firstRow, int lastCol, int lastRow, void* data );
+
+//Pages the chunks of a chunked world file in around the camera on a reader thread, and out again under a memory budget
+class WorldStream
+{
+	public:
+		//Initializes variables
+		WorldStream();
+
+		//Stops the reader
+		~WorldStream();
+
+		//Reads the header and chunk index and starts the reader, tile types must be below tileTypes
+		bool open( std::string path, int tileTypes );
+
+		//Stops the reader and frees the chunks
+		void close();
+
+		//Gets the tile type at a grid cell, 0 while its chunk isn't resident
+		int getType( int col, int row )
+		{
+			const Uint8* tiles = mTiles[ ( row >> mChunkShift ) * mChunkColumns + ( col >> mChunkShift ) ];
+			return tiles != NULL ? tiles[ ( ( row & mChunkMask ) << mChunkShift ) + ( col & mChunkMask ) ] : 0;
+		}
+
+		//Installs chunks that arrived, requests the chunks around the camera and ahead of its motion, and evicts far ones
+		void update( const SDL_Rect& camera );
+
+		//Updates until the chunks around the camera are resident
+		void wait( const SDL_Rect& camera );
+
+		//Sets the most bytes of chunk tiles kept, chunks around the camera are kept regardless
+		void setBudget( size_t bytes ) { mBudget = bytes; }
+
+		//Sets the function told about arriving chunks
+		void setLoadedCallback( ChunkLoaded callback, void* data );
+
+		//Gets world dimensions
+		int getColumns() { return mColumns; }
+		int getRows() { return mRows; }
+		int getTileWidth() { return mTileWidth; }
+		int getTileHeight() { return mTileHeight; }
+
+		//Gets the chunk side in tiles as a power of two
+		int getChunkShift() { return mChunkShift; }
+
+		//Gets the chunks and bytes resident
+		int getResidentCount() { return (int)mResident.size(); }
+		size_t getMemoryUsage();
+
+	private:
+		//Chunk states
+		enum
+		{
+			CHUNK_ABSENT,
+			CHUNK_REQUESTED,
+			CHUNK_RESIDENT,
+			CHUNK_FAILED
+		};
+
+		//Reader thread entry point
+		static int readerMain( void* stream );
+
+		//Reads and checks one chunk, NULL if it is bad
+		Uint8* read( int chunk );
+
+		//Gets the chunks a pixel area covers, false if it is outside the world
+		bool getChunkSpan( SDL_Rect area, int& firstCol, int& firstRow, int& lastCol, int& lastRow );
+
+		//Marks the chunks of a span wanted and lists the ones to request
+		void want( int firstCol, int firstRow, int lastCol, int lastRow, std::vector<int>& requests );
+
+		//Frees a resident chunk
+		void evict( int chunk );
+
+		//The world file, only read by the reader thread once it runs
+		FILE* mFile;
+		std::vector<WorldChunk> mIndex;
+		int mTileTypes;
+
+		//World and chunk dimensions
+		int mColumns;
+		int mRows;
+		int mTileWidth;
+		int mTileHeight;
+		int mChunkColumns;
+		int mChunkRows;
+		int mChunkShift;
+		int mChunkMask;
+		size_t mChunkBytes;
+
+		//Tiles of each chunk, NULL unless resident, and chunk states
+		std::vector<Uint8*> mTiles;
+		std::vector<Uint8> mState;
+
+		//Update each chunk was last wanted in
+		std::vector<Uint32> mWanted;
+		Uint32 mGeneration;
+
+		//Resident chunks
+		std::vector<int> mResident;
+		size_t mBudget;
+
+		//Camera at the last update, for the direction of travel
+		SDL_Rect mLastCamera;
+		bool mHasLastCamera;
+
+		//Chunks waiting for the reader, and read chunks waiting for update
+		std::deque<int> mRequests;
+		std::vector< std::pair<int, Uint8*> > mArrived;
+		SDL_mutex* mLock;
+		SDL_cond* mRequestReady;
+		bool mQuit;
+		SDL_Thread* mReader;
+
+		//Arrival callback
+		ChunkLoaded mLoaded;
+		void* mLoadedData;
+};
+
+#endif
@@ -0,0 +1,438 @@
+//Packs sprites from several sheets into power of two atlas pages
+//Usage: atlaspack input.pack output-prefix
+//Writes <prefix><N>.png and a matching <prefix><N>.atlas descriptor for each page
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//A sprite to pack
+struct PackSprite
+{
+	//Name in the descriptor, and the group before its slash
+	std::string name;
+	std::string group;
+
+	//Where it comes from
+	SDL_Surface* sheet;
+	SDL_Rect source;
+
+	//Where it goes
+	int page;
+	int x;
+	int y;
+};
+
+//A row of sprites on a page
+struct Shelf
+{
+	int y;
+	int height;
+	int width;
+};
+
+//An atlas page being filled
+struct Page
+{
+	std::vector<Shelf> shelves;
+	int width;
+	int height;
+};
+
+//Loaded sheets by path, in RGBA
+std::map<std::string, SDL_Surface*> gSheets;
+
+//Loads a sheet once
+SDL_Surface* loadSheet( const std::string& path )
+{
+	std::map<std::string, SDL_Surface*>::iterator found = gSheets.find( path );
+	if( found != gSheets.end() )
+	{
+		return found->second;
+	}
+
+	SDL_Surface* loaded = IMG_Load( path.c_str() );
+	if( loaded == NULL )
+	{
+		printf( "Unable to load image %s! SDL_image Error: %s\n", path.c_str(), IMG_GetError() );
+		return NULL;
+	}
+	SDL_Surface* sheet = SDL_ConvertSurfaceFormat( loaded, SDL_PIXELFORMAT_RGBA32, 0 );
+	SDL_FreeSurface( loaded );
+	if( sheet == NULL )
+	{
+		printf( "Unable to convert %s! SDL Error: %s\n", path.c_str(), SDL_GetError() );
+		return NULL;
+	}
+
+	gSheets[ path ] = sheet;
+	return sheet;
+}
+
+//Reads the rest of a line, for paths with spaces
+std::string restOfLine( std::istringstream& fields )
+{
+	std::string rest;
+	std::getline( fields >> std::ws, rest );
+	while( !rest.empty() && ( rest[ rest.size() - 1 ] == '\r' || rest[ rest.size() - 1 ] == ' ' ) )
+	{
+		rest.erase( rest.size() - 1 );
+	}
+	return rest;
+}
+
+//Reads the pack file
+bool readPack( const char* path, int& size, int& padding, std::vector<PackSprite>& sprites )
+{
+	std::ifstream pack( path );
+	if( !pack.is_open() )
+	{
+		printf( "Unable to open %s!\n", path );
+		return false;
+	}
+
+	std::string line;
+	int lineNumber = 0;
+	while( std::getline( pack, line ) )
+	{
+		lineNumber++;
+		std::istringstream fields( line );
+		std::string command;
+
+		//Skip blank lines and comments
+		if( !( fields >> command ) || command[ 0 ] == '#' )
+		{
+			continue;
+		}
+
+		bool success = true;
+		if( command == "size" )
+		{
+			success = (bool)( fields >> size ) && size > 0;
+		}
+		else if( command == "padding" )
+		{
+			success = (bool)( fields >> padding ) && padding >= 0;
+		}
+		else if( command == "sprite" || command == "sheet" )
+		{
+			PackSprite sprite;
+			success = (bool)( fields >> sprite.name );
+			if( success && command == "sprite" )
+			{
+				success = (bool)( fields >> sprite.source.x >> sprite.source.y >> sprite.source.w >> sprite.source.h );
+			}
+
+			//Load the sheet it comes from
+			std::string sheetPath = restOfLine( fields );
+			sprite.sheet = success && !sheetPath.empty() ? loadSheet( sheetPath ) : NULL;
+			success = sprite.sheet != NULL;
+
+			if( success )
+			{
+				if( command == "sheet" )
+				{
+					sprite.source.x = 0;
+					sprite.source.y = 0;
+					sprite.source.w = sprite.sheet->w;
+					sprite.source.h = sprite.sheet->h;
+				}
+
+				//The rect has to be on the sheet
+				success = sprite.source.x >= 0 && sprite.source.y >= 0 && sprite.source.w > 0 && sprite.source.h > 0 &&
+					sprite.source.x + sprite.source.w <= sprite.sheet->w && sprite.source.y + sprite.source.h <= sprite.sheet->h;
+			}
+
+			sprite.group = sprite.name.substr( 0, sprite.name.find( '/' ) );
+			sprite.page = -1;
+			sprite.x = 0;
+			sprite.y = 0;
+			sprites.push_back( sprite );
+		}
+		else
+		{
+			success = false;
+		}
+
+		if( !success )
+		{
+			printf( "Error in %s: Bad line %d!\n", path, lineNumber );
+			return false;
+		}
+	}
+
+	return true;
+}
+
+//Finds room for a padded sprite on a page no wider than maxWidth, first fit on shelves
+bool place( Page& page, int maxWidth, int size, int width, int height, int& x, int& y )
+{
+	for( size_t i = 0; i < page.shelves.size(); ++i )
+	{
+		Shelf& shelf = page.shelves[ i ];
+		if( height <= shelf.height && shelf.width + width <= maxWidth )
+		{
+			x = shelf.width;
+			y = shelf.y;
+			shelf.width += width;
+			page.width = std::max( page.width, shelf.width );
+			return true;
+		}
+	}
+
+	//Open a new shelf under the others
+	if( page.height + height > size || width > maxWidth )
+	{
+		return false;
+	}
+	Shelf shelf = { page.height, height, width };
+	page.shelves.push_back( shelf );
+	x = 0;
+	y = page.height;
+	page.height += height;
+	page.width = std::max( page.width, width );
+	return true;
+}
+
+//Taller sprites first packs shelves tighter
+bool tallerFirst( const PackSprite* a, const PackSprite* b )
+{
+	return a->source.h > b->source.h;
+}
+
+//Places every sprite on pages no wider than maxWidth, keeping each group on one page
+bool pack( std::vector<PackSprite>& sprites, int maxWidth, int size, int padding, std::vector<Page>& pages )
+{
+	//Groups in the order they first appear
+	std::vector<std::string> groups;
+	for( size_t i = 0; i < sprites.size(); ++i )
+	{
+		if( std::find( groups.begin(), groups.end(), sprites[ i ].group ) == groups.end() )
+		{
+			groups.push_back( sprites[ i ].group );
+		}
+	}
+
+	Page empty = { std::vector<Shelf>(), 0, 0 };
+	pages.push_back( empty );
+	for( size_t g = 0; g < groups.size(); ++g )
+	{
+		std::vector<PackSprite*> members;
+		for( size_t i = 0; i < sprites.size(); ++i )
+		{
+			if( sprites[ i ].group == groups[ g ] )
+			{
+				members.push_back( &sprites[ i ] );
+			}
+		}
+		std::stable_sort( members.begin(), members.end(), tallerFirst );
+
+		//Try the last page, then a fresh one
+		bool placed = false;
+		for( int attempt = 0; attempt < 2 && !placed; ++attempt )
+		{
+			if( attempt == 1 )
+			{
+				//Already on an empty page
+				if( pages.back().shelves.empty() )
+				{
+					break;
+				}
+				pages.push_back( empty );
+			}
+
+			Page trial = pages.back();
+			placed = true;
+			for( size_t i = 0; i < members.size() && placed; ++i )
+			{
+				placed = place( trial, maxWidth, size, members[ i ]->source.w + padding * 2, members[ i ]->source.h + padding * 2, members[ i ]->x, members[ i ]->y );
+				members[ i ]->x += padding;
+				members[ i ]->y += padding;
+				members[ i ]->page = (int)pages.size() - 1;
+			}
+			if( placed )
+			{
+				pages.back() = trial;
+			}
+		}
+
+		if( !placed )
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+//Smallest power of two at least value
+int powerOfTwo( int value )
+{
+	int power = 1;
+	while( power < value )
+	{
+		power *= 2;
+	}
+	return power;
+}
+
+//Copies a sprite onto a page, repeating its edge pixels into the padding
+void blit( PackSprite& sprite, SDL_Surface* page, int padding )
+{
+	for( int y = -padding; y < sprite.source.h + padding; ++y )
+	{
+		int sourceY = sprite.source.y + std::min( std::max( y, 0 ), sprite.source.h - 1 );
+		Uint32* from = (Uint32*)( (Uint8*)sprite.sheet->pixels + sourceY * sprite.sheet->pitch );
+		Uint32* to = (Uint32*)( (Uint8*)page->pixels + ( sprite.y + y ) * page->pitch );
+		for( int x = -padding; x < sprite.source.w + padding; ++x )
+		{
+			int sourceX = sprite.source.x + std::min( std::max( x, 0 ), sprite.source.w - 1 );
+			to[ sprite.x + x ] = from[ sourceX ];
+		}
+	}
+}
+
+//Writes a page image and its descriptor
+bool writePage( std::vector<PackSprite>& sprites, Page& page, int index, int padding, const char* pack, const char* prefix )
+{
+	char imagePath[ 1024 ];
+	char atlasPath[ 1024 ];
+	snprintf( imagePath, sizeof( imagePath ), "%s%d.png", prefix, index );
+	snprintf( atlasPath, sizeof( atlasPath ), "%s%d.atlas", prefix, index );
+
+	//Draw the sprites
+	int width = powerOfTwo( page.width );
+	int height = powerOfTwo( page.height );
+	SDL_Surface* image = SDL_CreateRGBSurfaceWithFormat( 0, width, height, 32, SDL_PIXELFORMAT_RGBA32 );
+	if( image == NULL )
+	{
+		printf( "Unable to create %dx%d page! SDL Error: %s\n", width, height, SDL_GetError() );
+		return false;
+	}
+	SDL_FillRect( image, NULL, 0 );
+	for( size_t i = 0; i < sprites.size(); ++i )
+	{
+		if( sprites[ i ].page == index )
+		{
+			blit( sprites[ i ], image, padding );
+		}
+	}
+	bool saved = IMG_SavePNG( image, imagePath ) == 0;
+	SDL_FreeSurface( image );
+	if( !saved )
+	{
+		printf( "Unable to save %s! SDL_image Error: %s\n", imagePath, IMG_GetError() );
+		return false;
+	}
+
+	//Describe where each sprite went
+	FILE* out = fopen( atlasPath, "w" );
+	if( out == NULL )
+	{
+		printf( "Unable to open %s for writing!\n", atlasPath );
+		return false;
+	}
+	fprintf( out, "#Generated by atlaspack from %s\n", pack );
+	fprintf( out, "image %s\n", imagePath );
+	int id = 0;
+	int count = 0;
+	for( size_t i = 0; i < sprites.size(); ++i )
+	{
+		PackSprite& sprite = sprites[ i ];
+		if( sprite.page == index )
+		{
+			fprintf( out, "sprite %d %d %d %d %d %s\n", id++, sprite.x, sprite.y, sprite.source.w, sprite.source.h, sprite.name.c_str() );
+			count++;
+		}
+	}
+	if( fclose( out ) != 0 )
+	{
+		printf( "Unable to write %s!\n", atlasPath );
+		return false;
+	}
+
+	printf( "%s: %dx%d, %d sprites\n", imagePath, width, height, count );
+	return true;
+}
+
+int main( int argc, char* args[] )
+{
+	if( argc != 3 )
+	{
+		printf( "Usage: %s input.pack output-prefix\n", args[ 0 ] );
+		return 1;
+	}
+
+	//PNG loading and saving
+	if( !( IMG_Init( IMG_INIT_PNG ) & IMG_INIT_PNG ) )
+	{
+		printf( "SDL_image could not initialize! SDL_image Error: %s\n", IMG_GetError() );
+		return 1;
+	}
+
+	//Read the sprites
+	int size = 2048;
+	int padding = 2;
+	std::vector<PackSprite> sprites;
+	bool success = readPack( args[ 1 ], size, padding, sprites );
+
+	//Lay them out at each power of two width, keeping the fewest pages with the least area
+	std::vector<PackSprite> best;
+	std::vector<Page> pages;
+	long bestArea = 0;
+	int bestSide = 0;
+	for( int width = 1; success && width <= size; width *= 2 )
+	{
+		std::vector<PackSprite> trial = sprites;
+		std::vector<Page> trialPages;
+		if( pack( trial, width, size, padding, trialPages ) )
+		{
+			//Ties go to squarer pages
+			long area = 0;
+			int side = 0;
+			for( size_t i = 0; i < trialPages.size(); ++i )
+			{
+				int pageWidth = powerOfTwo( trialPages[ i ].width );
+				int pageHeight = powerOfTwo( trialPages[ i ].height );
+				area += (long)pageWidth * pageHeight;
+				side = std::max( side, std::max( pageWidth, pageHeight ) );
+			}
+			if( best.empty() || trialPages.size() < pages.size() ||
+				( trialPages.size() == pages.size() && ( area < bestArea || ( area == bestArea && side < bestSide ) ) ) )
+			{
+				best = trial;
+				pages = trialPages;
+				bestArea = area;
+				bestSide = side;
+			}
+		}
+	}
+	if( success && best.empty() && !sprites.empty() )
+	{
+		printf( "A sprite group doesn't fit on a %dx%d page!\n", size, size );
+		success = false;
+	}
+	sprites = best;
+
+	//Write the pages
+	for( size_t i = 0; success && i < pages.size(); ++i )
+	{
+		success = writePage( sprites, pages[ i ], (int)i, padding, args[ 1 ], args[ 2 ] );
+	}
+
+	//Free the sheets
+	for( std::map<std::string, SDL_Surface*>::iterator i = gSheets.begin(); i != gSheets.end(); ++i )
+	{
+		SDL_FreeSurface( i->second );
+	}
+	IMG_Quit();
+
+	return success ? 0 : 1;
+}
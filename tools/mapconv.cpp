@@ -0,0 +1,161 @@
+//Converts text tile maps into the binary map format, or into chunked worlds for streaming
+//Usage: mapconv [--repeat <n>] input.map output.rkm|output.rkw
+//--repeat lays the map out n by n times, for building large test worlds
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "../src/level.h"
+#include "../src/mapformat.h"
+
+//Writes the map as one block of tiles
+bool writeMap( Level& level, int repeat, const char* path )
+{
+	//Copy out the tiles
+	int columns = level.getColumns() * repeat;
+	int rows = level.getRows() * repeat;
+	std::vector<uint8_t> tiles( (size_t)columns * rows );
+	for( int row = 0; row < rows; ++row )
+	{
+		for( int col = 0; col < columns; ++col )
+		{
+			tiles[ (size_t)row * columns + col ] = (uint8_t)level.getType( col % level.getColumns(), row % level.getRows() );
+		}
+	}
+
+	//Fill in the header
+	MapHeader header;
+	memset( &header, 0, sizeof( header ) );
+	memcpy( header.magic, MAP_MAGIC, sizeof( header.magic ) );
+	header.version = MAP_VERSION;
+	header.columns = columns;
+	header.rows = rows;
+	header.tileWidth = TILE_WIDTH;
+	header.tileHeight = TILE_HEIGHT;
+	header.layers = 1;
+	header.checksum = mapChecksum( &tiles[ 0 ], tiles.size() );
+	header.dataOffset = sizeof( MapHeader );
+
+	//Write the header and the tiles right after it
+	FILE* out = fopen( path, "wb" );
+	if( out == NULL )
+	{
+		printf( "Unable to open %s for writing!\n", path );
+		return false;
+	}
+	bool written = fwrite( &header, sizeof( header ), 1, out ) == 1 && fwrite( &tiles[ 0 ], 1, tiles.size(), out ) == tiles.size();
+	if( fclose( out ) != 0 || !written )
+	{
+		printf( "Unable to write %s!\n", path );
+		return false;
+	}
+
+	printf( "%s: %dx%d tiles, %lu bytes\n", path, columns, rows, (unsigned long)( sizeof( header ) + tiles.size() ) );
+	return true;
+}
+
+//Writes the map as a chunk index followed by the chunks
+bool writeWorld( Level& level, int repeat, const char* path )
+{
+	int columns = level.getColumns() * repeat;
+	int rows = level.getRows() * repeat;
+	int chunkColumns = ( columns + WORLD_CHUNK_TILES - 1 ) / WORLD_CHUNK_TILES;
+	int chunkRows = ( rows + WORLD_CHUNK_TILES - 1 ) / WORLD_CHUNK_TILES;
+	size_t chunkBytes = (size_t)WORLD_CHUNK_TILES * WORLD_CHUNK_TILES;
+
+	//Fill in the header
+	WorldHeader header;
+	memset( &header, 0, sizeof( header ) );
+	memcpy( header.magic, WORLD_MAGIC, sizeof( header.magic ) );
+	header.version = WORLD_VERSION;
+	header.columns = columns;
+	header.rows = rows;
+	header.tileWidth = TILE_WIDTH;
+	header.tileHeight = TILE_HEIGHT;
+	header.chunkTiles = WORLD_CHUNK_TILES;
+	header.layers = 1;
+	header.indexOffset = sizeof( WorldHeader );
+
+	FILE* out = fopen( path, "wb" );
+	if( out == NULL )
+	{
+		printf( "Unable to open %s for writing!\n", path );
+		return false;
+	}
+
+	//The index goes after the header and the chunks after the index
+	std::vector<WorldChunk> index( (size_t)chunkColumns * chunkRows );
+	uint64_t offset = sizeof( WorldHeader ) + index.size() * sizeof( WorldChunk );
+	bool written = fwrite( &header, sizeof( header ), 1, out ) == 1 && fwrite( &index[ 0 ], sizeof( WorldChunk ), index.size(), out ) == index.size();
+
+	//Write the chunks row by row, padding past the world edge with the first tile type
+	std::vector<uint8_t> chunk( chunkBytes );
+	for( int chunkRow = 0; written && chunkRow < chunkRows; ++chunkRow )
+	{
+		for( int chunkCol = 0; written && chunkCol < chunkColumns; ++chunkCol )
+		{
+			for( int y = 0; y < WORLD_CHUNK_TILES; ++y )
+			{
+				for( int x = 0; x < WORLD_CHUNK_TILES; ++x )
+				{
+					int col = chunkCol * WORLD_CHUNK_TILES + x;
+					int row = chunkRow * WORLD_CHUNK_TILES + y;
+					chunk[ y * WORLD_CHUNK_TILES + x ] = ( col < columns && row < rows ) ? (uint8_t)level.getType( col % level.getColumns(), row % level.getRows() ) : 0;
+				}
+			}
+
+			WorldChunk& entry = index[ (size_t)chunkRow * chunkColumns + chunkCol ];
+			entry.offset = offset;
+			entry.size = (uint32_t)chunkBytes;
+			entry.checksum = mapChecksum( &chunk[ 0 ], chunkBytes );
+			offset += chunkBytes;
+
+			written = fwrite( &chunk[ 0 ], 1, chunkBytes, out ) == chunkBytes;
+		}
+	}
+
+	//Go back and fill in the index
+	written = written && fseek( out, header.indexOffset, SEEK_SET ) == 0 && fwrite( &index[ 0 ], sizeof( WorldChunk ), index.size(), out ) == index.size();
+	if( fclose( out ) != 0 || !written )
+	{
+		printf( "Unable to write %s!\n", path );
+		return false;
+	}
+
+	printf( "%s: %dx%d tiles in %dx%d chunks, %lu bytes\n", path, columns, rows, chunkColumns, chunkRows, (unsigned long)offset );
+	return true;
+}
+
+int main( int argc, char* args[] )
+{
+	//Read the settings
+	int repeat = 1;
+	int first = 1;
+	if( argc == 5 && strcmp( args[ 1 ], "--repeat" ) == 0 )
+	{
+		repeat = atoi( args[ 2 ] );
+		first = 3;
+	}
+	if( argc != first + 2 || repeat < 1 )
+	{
+		printf( "Usage: %s [--repeat <n>] input.map output.rkm|output.rkw\n", args[ 0 ] );
+		return 1;
+	}
+	const char* input = args[ first ];
+	const char* output = args[ first + 1 ];
+
+	//Parse the text map
+	Level level;
+	if( !level.loadFromFile( input ) )
+	{
+		printf( "Failed to load %s!\n", input );
+		return 1;
+	}
+
+	//The output extension picks the format
+	size_t length = strlen( output );
+	bool world = length > 4 && strcmp( output + length - 4, ".rkw" ) == 0;
+
+	return ( world ? writeWorld( level, repeat, output ) : writeMap( level, repeat, output ) ) ? 0 : 1;
+}